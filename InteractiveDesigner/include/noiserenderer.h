@@ -1,6 +1,7 @@
 #ifndef NOISERENDERER_H
 #define NOISERENDERER_H
 
+#include <memory>
 #include <vector>
 
 #include <QObject>
@@ -12,6 +13,7 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "noiseparameters.h"
+#include "pointstore.h"
 
 class NoiseRenderer : public QObject
 {
@@ -109,6 +111,11 @@ private:
 
 	NoiseParameters m_parameters;
 
+	/**
+	 * \brief Points of the current seed, kept between renderings
+	 */
+	std::shared_ptr<PointStore> m_pointStore;
+
 	VectorDouble2D m_result;
 };
 
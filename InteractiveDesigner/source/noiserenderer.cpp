@@ -8,7 +8,8 @@
 NoiseRenderer::NoiseRenderer(QObject *parent, const NoiseParameters& parameters)
 	: QObject(parent),
 	m_futureImageWatcher(new QFutureWatcher<VectorDouble2D>(this)),
-	m_parameters(parameters)
+	m_parameters(parameters),
+	m_pointStore(PointStore::shared(parameters.seed, parameters.epsilon, RandomGeneratorType::MersenneTwister))
 {
 	ConfigureFutureWatcher();
 }
@@ -16,6 +17,7 @@ NoiseRenderer::NoiseRenderer(QObject *parent, const NoiseParameters& parameters)
 void NoiseRenderer::setParameters(const NoiseParameters& parameters)
 {
 	m_parameters = parameters;
+	m_pointStore = PointStore::shared(parameters.seed, parameters.epsilon, RandomGeneratorType::MersenneTwister);
 }
 
 QImage NoiseRenderer::resultQImage() const
@@ -125,7 +127,9 @@ NoiseRenderer::VectorDouble2D NoiseRenderer::RenderTerrain() const
 		false,
 		false,
 		false,
-		false);
+		false,
+		RandomGeneratorType::MersenneTwister,
+		m_pointStore);
 
 	VectorDouble2D result(m_parameters.heightResolution, m_parameters.widthResolution);
 
@@ -168,7 +172,9 @@ NoiseRenderer::VectorDouble2D NoiseRenderer::RenderLichtenberg() const
 		false,
 		true,
 		false,
-		false);
+		false,
+		RandomGeneratorType::MersenneTwister,
+		m_pointStore);
 
 	VectorDouble2D result(m_parameters.heightResolution, m_parameters.widthResolution);
 
@@ -1,10 +1,13 @@
 #include "examples.h"
 
+#include <array>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <memory>
 #include <cassert>
 #include <chrono>
+#include <random>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -13,13 +16,19 @@
 #include "noise.h"
 #include "math2d.h"
 #include "utils.h"
+#include "perlin.h"
 #include "perlincontrolfunction.h"
 #include "planecontrolfunction.h"
 #include "lichtenbergcontrolfunction.h"
 #include "imagecontrolfunction.h"
+#include "tiledimagecontrolfunction.h"
+#include "controlfunctioncache.h"
 
 using namespace std;
 
+// Size in pixels of the tiles in which images are evaluated
+const int TILE_SIZE = 64;
+
 struct Progress
 {
 	const int totalSteps;
@@ -90,28 +99,58 @@ cv::Mat SegmentImage(const Noise<I>& noise, const Point2D& a, const Point2D&b, i
 	return image;
 }
 
-template<typename I>
-vector<vector<double> > EvaluateTerrain(const Noise<I>& noise, const Point2D& a, const Point2D&b, int width, int height)
+/// <summary>
+/// Evaluate an image covering the noise domain tile by tile, in parallel.
+/// </summary>
+/// <param name="evaluateTile">Function evaluating the pixels of a tile</param>
+/// <param name="width">Width of the image</param>
+/// <param name="height">Height of the image</param>
+/// <param name="displayProgress">Whether the progress should be displayed</param>
+template<typename V, typename TileFunction>
+vector<vector<V> > EvaluateTiles(const TileFunction& evaluateTile, int width, int height, bool displayProgress)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	vector<vector<V> > values(height, vector<V>(width));
 
-	// Display progress 25 times.
-	Progress progress(width * height, 25);
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	const int tiles = tilesX * tilesY;
 
-	// Measure execution time
-	const auto startTime = chrono::high_resolution_clock::now();
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
-		for (int j = 0; j < width; j++) {
-			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
-			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+	// Display progress 25 times, or once per tile if there are less tiles.
+	Progress progress(tiles, min(tiles, 25));
+
+#pragma omp parallel for shared(values) schedule(dynamic)
+	for (int t = 0; t < tiles; t++) {
+		const int left = (t % tilesX) * TILE_SIZE;
+		const int top = (t / tilesX) * TILE_SIZE;
+		const TileRect rect(left, top, min(TILE_SIZE, width - left), min(TILE_SIZE, height - top));
 
-			values[i][j] = noise.evaluateTerrain(x, y);
+		vector<V> tile;
+		evaluateTile(rect, tile);
 
+		for (int i = 0; i < rect.height; i++) {
+			for (int j = 0; j < rect.width; j++) {
+				values[rect.top + i][rect.left + j] = tile[i * rect.width + j];
+			}
+		}
+
+		if (displayProgress)
+		{
 			progress.Update();
 			progress.Display();
 		}
 	}
+
+	return values;
+}
+
+template<typename I, typename T, typename Display>
+vector<vector<double> > EvaluateTerrain(const Noise<I, T, Display>& noise, int width, int height)
+{
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	const auto values = EvaluateTiles<double>([&noise, width, height](const TileRect& rect, vector<double>& out) {
+		noise.evaluateTerrainTile(rect, width, height, out);
+	}, width, height, true);
 	const auto endTime = chrono::high_resolution_clock::now();
 
 	// Execution time in ms
@@ -120,28 +159,54 @@ vector<vector<double> > EvaluateTerrain(const Noise<I>& noise, const Point2D& a,
 	return values;
 }
 
-template<typename I>
-vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height)
+template<typename I, typename T, typename Display>
+vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I, T, Display>& noise, int width, int height)
 {
-	vector<vector<double> > values(height, vector<double>(width));
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	const auto values = EvaluateTiles<double>([&noise, width, height](const TileRect& rect, vector<double>& out) {
+		noise.evaluateLichtenbergTile(rect, width, height, out);
+	}, width, height, true);
+	const auto endTime = chrono::high_resolution_clock::now();
 
-	// Display progress 25 times.
-	Progress progress(width * height, 25);
+	// Execution time in ms
+	std::cout << "Execution time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
+
+	return values;
+}
 
+template<typename I, typename T, typename Display>
+vector<vector<double> > EvaluateLichtenbergFigureWithoutProgress(const Noise<I, T, Display>& noise, int width, int height)
+{
+	return EvaluateTiles<double>([&noise, width, height](const TileRect& rect, vector<double>& out) {
+		noise.evaluateLichtenbergTile(rect, width, height, out);
+	}, width, height, false);
+}
+
+template<typename I, typename T, typename Display>
+vector<vector<double> > DrawLichtenbergFigure(const Noise<I, T, Display>& noise, int width, int height)
+{
 	// Measure execution time
 	const auto startTime = chrono::high_resolution_clock::now();
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
-		for (int j = 0; j < width; j++) {
-			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
-			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+	const auto values = EvaluateTiles<double>([&noise, width, height](const TileRect& rect, vector<double>& out) {
+		noise.drawLichtenbergTile(rect, width, height, out);
+	}, width, height, true);
+	const auto endTime = chrono::high_resolution_clock::now();
 
-			values[i][j] = noise.evaluateLichtenberg(x, y);
+	// Execution time in ms
+	std::cout << "Execution time in ms: " << chrono::duration<double, milli>(endTime - startTime).count() << std::endl;
 
-			progress.Update();
-			progress.Display();
-		}
-	}
+	return values;
+}
+
+template<typename I, typename T, typename Display>
+vector<vector<TerrainChannels> > EvaluateTerrainChannels(const Noise<I, T, Display>& noise, int width, int height)
+{
+	// Measure execution time
+	const auto startTime = chrono::high_resolution_clock::now();
+	const auto values = EvaluateTiles<TerrainChannels>([&noise, width, height](const TileRect& rect, vector<TerrainChannels>& out) {
+		noise.evaluateTerrainChannelsTile(rect, width, height, out);
+	}, width, height, true);
 	const auto endTime = chrono::high_resolution_clock::now();
 
 	// Execution time in ms
@@ -150,18 +215,18 @@ vector<vector<double> > EvaluateLichtenbergFigure(const Noise<I>& noise, const P
 	return values;
 }
 
-template<typename I>
-vector<vector<double> > EvaluateLichtenbergFigureWithoutProgress(const Noise<I>& noise, const Point2D& a, const Point2D& b, int width, int height)
+/// <summary>
+/// Extract a channel from the outputs of a terrain
+/// </summary>
+/// <param name="channels">Outputs of the pixels of the terrain</param>
+/// <param name="channel">Member of TerrainChannels to extract</param>
+vector<vector<double> > TerrainChannel(const vector<vector<TerrainChannels> >& channels, double TerrainChannels::* channel)
 {
-	vector<vector<double> > values(height, vector<double>(width));
-
-#pragma omp parallel for shared(values)
-	for (int i = 0; i < height; i++) {
-		for (int j = 0; j < width; j++) {
-			const double x = remap_clamp(double(j), 0.0, double(width), a.x, b.x);
-			const double y = remap_clamp(double(i), 0.0, double(height), a.y, b.y);
+	vector<vector<double> > values(channels.size(), vector<double>(channels.front().size()));
 
-			values[i][j] = noise.evaluateLichtenberg(x, y);
+	for (size_t i = 0; i < channels.size(); i++) {
+		for (size_t j = 0; j < channels[i].size(); j++) {
+			values[i][j] = channels[i][j].*channel;
 		}
 	}
 
@@ -314,9 +379,14 @@ void SmallAmplificationImage(int width, int height, int seed, const string& inpu
 	const Point2D controlFunctionTopLeft(0.0, 0.0);
 	const Point2D controlFunctionBottomRight(1.0, 1.0);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
+	// The bicubic interpolation of the image is costly, keep its values at the cell points
+	const std::shared_ptr<ControlFunctionCache> controlFunctionCache = std::make_shared<ControlFunctionCache>();
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false, RandomGeneratorType::MersenneTwister, nullptr, controlFunctionCache);
 	// TODO: Random generator std::minstd_rand
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
+
+	std::cout << "Control function cache hit rate: " << 100.0 * controlFunctionCache->statistics().hitRate() << " %" << std::endl;
 
 	cv::imwrite(filename, image);
 }
@@ -339,89 +409,77 @@ void BigAmplificationImage(int width, int height, int seed, const string& input,
 	const Point2D controlFunctionTopLeft(0.1, 0.1);
 	const Point2D controlFunctionBottomRight(0.9, 0.9);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
-	// TODO: Random generator std::minstd_rand
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
-
-	cv::imwrite(filename, image);
-}
-
-void EffectBetaTerrainImage(int width, int height, int seed, double beta, const string& filename)
-{
-	typedef PerlinControlFunction ControlFunctionType;
-	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+	// The bicubic interpolation of the image is costly, keep its values at the cell points
+	const std::shared_ptr<ControlFunctionCache> controlFunctionCache = std::make_shared<ControlFunctionCache>();
 
-	const double eps = 0.25;
-	const int resolution = 2;
-	const double displacement = 0.08;
-	const int primitivesResolutionSteps = 3;
-	const double slopePower = beta;
-	const double noiseAmplitudeProportion = 0.025;
-	const Point2D noiseTopLeft(0.0, 0.0);
-	const Point2D noiseBottomRight(4.0, 4.0);
-	const Point2D controlFunctionTopLeft(0.0, 0.0);
-	const Point2D controlFunctionBottomRight(0.5, 0.5);
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false, RandomGeneratorType::MersenneTwister, nullptr, controlFunctionCache);
+	// TODO: Random generator std::minstd_rand
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
-	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	std::cout << "Control function cache hit rate: " << 100.0 * controlFunctionCache->statistics().hitRate() << " %" << std::endl;
 
 	cv::imwrite(filename, image);
 }
 
-void TeaserFirstDistanceImage(int width, int height, int seed, const std::string& filename)
+void TiledAmplificationImage(int width, int height, int seed, const string& input, const string& tiledInput, const string& filename)
 {
-	typedef PerlinControlFunction ControlFunctionType;
-	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+	// Offline conversion of the image in a tiled file, only done once for an image
+	if (!TiledImageControlFunction::convert(cv::imread(input, cv::ImreadModes::IMREAD_ANYDEPTH), tiledInput))
+	{
+		std::cout << "Cannot write the tiled file " << tiledInput << std::endl;
+		return;
+	}
 
-	const double eps = 0.25;
+	typedef TiledImageControlFunction ControlFunctionType;
+	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>(tiledInput));
+
+	const double eps = 0.10;
 	const int resolution = 1;
-	const double displacement = 0.075;
+	const double displacement = 0.05;
 	const int primitivesResolutionSteps = 3;
-	const double slopePower = 0.5;
+	const double slopePower = 0.75;
 	const double noiseAmplitudeProportion = 0.05;
 	const Point2D noiseTopLeft(0.0, 0.0);
-	const Point2D noiseBottomRight(4.0, 4.0);
-	const Point2D controlFunctionTopLeft(-0.2, -0.5);
-	const Point2D controlFunctionBottomRight(1.40, 0.7);
+	const Point2D noiseBottomRight(16.0, 16.0);
+	const Point2D controlFunctionTopLeft(0.1, 0.1);
+	const Point2D controlFunctionBottomRight(0.9, 0.9);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true);
-	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
 
-void TeaserFirstTerrainImage(int width, int height, int seed, const std::string& filename)
+void EffectBetaTerrainImage(int width, int height, int seed, double beta, const string& filename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
 
 	const double eps = 0.25;
-	const int resolution = 1;
-	const double displacement = 0.075;
+	const int resolution = 2;
+	const double displacement = 0.08;
 	const int primitivesResolutionSteps = 3;
-	const double slopePower = 0.5;
-	const double noiseAmplitudeProportion = 0.05;
+	const double slopePower = beta;
+	const double noiseAmplitudeProportion = 0.025;
 	const Point2D noiseTopLeft(0.0, 0.0);
 	const Point2D noiseBottomRight(4.0, 4.0);
-	const Point2D controlFunctionTopLeft(-0.2, -0.5);
-	const Point2D controlFunctionBottomRight(1.40, 0.7);
+	const Point2D controlFunctionTopLeft(0.0, 0.0);
+	const Point2D controlFunctionBottomRight(0.5, 0.5);
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
 
-void TeaserSecondDistanceImage(int width, int height, int seed, const std::string& filename)
+void TeaserFirstImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
 
 	const double eps = 0.25;
-	const int resolution = 2;
+	const int resolution = 1;
 	const double displacement = 0.075;
 	const int primitivesResolutionSteps = 3;
 	const double slopePower = 0.5;
@@ -431,14 +489,16 @@ void TeaserSecondDistanceImage(int width, int height, int seed, const std::strin
 	const Point2D controlFunctionTopLeft(-0.2, -0.5);
 	const Point2D controlFunctionBottomRight(1.40, 0.7);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true);
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	// The distance and the terrain are evaluated in a single pass
+	const auto channels = EvaluateTerrainChannels(noise, width, height);
 
-	cv::imwrite(filename, image);
+	cv::imwrite(distanceFilename, GenerateImageMatlab(TerrainChannel(channels, &TerrainChannels::distance)));
+	cv::imwrite(terrainFilename, GenerateImage(TerrainChannel(channels, &TerrainChannels::height)));
 }
 
-void TeaserSecondTerrainImage(int width, int height, int seed, const string& filename)
+void TeaserSecondImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
@@ -456,35 +516,14 @@ void TeaserSecondTerrainImage(int width, int height, int seed, const string& fil
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	// The distance and the terrain are evaluated in a single pass
+	const auto channels = EvaluateTerrainChannels(noise, width, height);
 
-	cv::imwrite(filename, image);
+	cv::imwrite(distanceFilename, GenerateImageMatlab(TerrainChannel(channels, &TerrainChannels::distance)));
+	cv::imwrite(terrainFilename, GenerateImage(TerrainChannel(channels, &TerrainChannels::height)));
 }
 
-void TeaserThirdDistanceImage(int width, int height, int seed, const std::string& filename)
-{
-	typedef PerlinControlFunction ControlFunctionType;
-	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>(0.250));
-
-	const double eps = 0.25;
-	const int resolution = 3;
-	const double displacement = 0.075;
-	const int primitivesResolutionSteps = 3;
-	const double slopePower = 0.1;
-	const double noiseAmplitudeProportion = 0.05;
-	const Point2D noiseTopLeft(0.0, 0.0);
-	const Point2D noiseBottomRight(4.0, 4.0);
-	const Point2D controlFunctionTopLeft(-0.2, -0.5);
-	const Point2D controlFunctionBottomRight(1.40, 0.7);
-
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true);
-	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageMatlab(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
-
-	cv::imwrite(filename, image);
-}
-
-void TeaserThirdTerrainImage(int width, int height, int seed, const string& filename)
+void TeaserThirdImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename)
 {
 	typedef PerlinControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>(0.250));
@@ -502,37 +541,14 @@ void TeaserThirdTerrainImage(int width, int height, int seed, const string& file
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	// The distance and the terrain are evaluated in a single pass
+	const auto channels = EvaluateTerrainChannels(noise, width, height);
 
-	cv::imwrite(filename, image);
+	cv::imwrite(distanceFilename, GenerateImageMatlab(TerrainChannel(channels, &TerrainChannels::distance)));
+	cv::imwrite(terrainFilename, GenerateImage(TerrainChannel(channels, &TerrainChannels::height)));
 }
 
-void SketchSegmentsImage(int width, int height, int seed, const std::string& input, const std::string& filename)
-{
-	const auto inputImage = cv::imread(input, cv::ImreadModes::IMREAD_ANYDEPTH);
-
-	typedef ImageControlFunction ControlFunctionType;
-	std::unique_ptr<ControlFunctionType> controlFunction(std::make_unique<ControlFunctionType>(inputImage));
-
-	const double eps = 0.15;
-	const int resolution = 2;
-	const double displacement = 0.025;
-	const int primitivesResolutionSteps = 3;
-	const double slopePower = 0.5;
-	const double noiseAmplitudeProportion = 0.05;
-	const Point2D noiseTopLeft(0.0, 0.0);
-	const Point2D noiseBottomRight(8.0, 8.0);
-	const Point2D controlFunctionTopLeft(0.1, 0.1);
-	const Point2D controlFunctionBottomRight(0.9, 0.9);
-
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, true, false, false);
-	// TODO: Random generator std::minstd_rand
-	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
-
-	cv::imwrite(filename, image);
-}
-
-void SketchTerrainImage(int width, int height, int seed, const std::string& input, const std::string& filename)
+void SketchImages(int width, int height, int seed, const std::string& input, const std::string& segmentsFilename, const std::string& terrainFilename)
 {
 	const auto inputImage = cv::imread(input, cv::ImreadModes::IMREAD_ANYDEPTH);
 
@@ -552,9 +568,11 @@ void SketchTerrainImage(int width, int height, int seed, const std::string& inpu
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::minstd_rand
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	// The segments and the terrain are evaluated in a single pass
+	const auto channels = EvaluateTerrainChannels(noise, width, height);
 
-	cv::imwrite(filename, image);
+	cv::imwrite(segmentsFilename, GenerateImageNegative(TerrainChannel(channels, &TerrainChannels::mask)));
+	cv::imwrite(terrainFilename, GenerateImage(TerrainChannel(channels, &TerrainChannels::height)));
 }
 
 void EvaluationTerrainImage(int width, int height, int seed, const string& filename)
@@ -575,7 +593,7 @@ void EvaluationTerrainImage(int width, int height, int seed, const string& filen
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
@@ -598,7 +616,7 @@ void PerlinSegmentsImage(int width, int height, int seed, const std::string& fil
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, true, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
@@ -621,7 +639,7 @@ void PerlinPlaneSegmentsImage(int width, int height, int seed, const std::string
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, true, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImageNegative(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
@@ -644,15 +662,13 @@ void PerlinPlaneTerrainImage(int width, int height, int seed, const std::string&
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImage(EvaluateTerrain(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
 
 void LichtenbergFigureImage(int width, int height, int seed, const string& filename)
 {
-	const int antiAliasingLevel = 8;
-
 	typedef LichtenbergControlFunction ControlFunctionType;
 	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
 
@@ -669,13 +685,10 @@ void LichtenbergFigureImage(int width, int height, int seed, const string& filen
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImage(EvaluateLichtenbergFigure(noise, noiseTopLeft, noiseBottomRight, width, height));
-
-	// Resize image (anti aliasing)
-	cv::Mat resized_image(height / antiAliasingLevel, width / antiAliasingLevel, CV_16U);
-	cv::resize(image, resized_image, resized_image.size(), 0.0, 0.0, cv::INTER_AREA);
+	// Segments are drawn with anti aliasing at the resolution of the image
+	const cv::Mat image = GenerateImage(DrawLichtenbergFigure(noise, width, height));
 
-	cv::imwrite(filename, resized_image);
+	cv::imwrite(filename, image);
 }
 
 void EffectParametersImage(int width, int height, int seed, int resolution, double eps, double displacement, const std::string& filename)
@@ -693,11 +706,252 @@ void EffectParametersImage(int width, int height, int seed, int resolution, doub
 
 	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
 	// TODO: Random generator std::mt19937_64
-	const cv::Mat image = GenerateImageNegative(EvaluateLichtenbergFigure(noise, noiseTopLeft, noiseBottomRight, width, height));
+	const cv::Mat image = GenerateImageNegative(EvaluateLichtenbergFigure(noise, width, height));
 
 	cv::imwrite(filename, image);
 }
 
+void EffectResolutionImages(int width, int height, int seed, double eps, double displacement, const vector<string>& filenames)
+{
+	typedef LichtenbergControlFunction ControlFunctionType;
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+
+	// One image per resolution, from 1 to the number of files
+	const int resolution = int(filenames.size());
+	assert(resolution >= 1 && resolution <= MAX_LEVELS);
+
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 1.0;
+	const double noiseAmplitudeProportion = 0.0;
+	const Point2D noiseTopLeft(-2.0, -2.0);
+	const Point2D noiseBottomRight(1.0, 1.0);
+	const Point2D controlFunctionTopLeft(-1.0, -1.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
+	// TODO: Random generator std::mt19937_64
+	// All the resolutions are evaluated in a single pass
+	const auto levels = EvaluateTiles<array<double, MAX_LEVELS> >([&noise, width, height, resolution](const TileRect& rect, vector<array<double, MAX_LEVELS> >& out) {
+		vector<double> tile;
+		noise.evaluateLichtenbergLevelsTile(rect, width, height, tile);
+
+		const size_t area = size_t(rect.width) * rect.height;
+		out.resize(area);
+		for (size_t k = 0; k < area; k++) {
+			for (int l = 0; l < resolution; l++) {
+				out[k][l] = tile[l * area + k];
+			}
+		}
+	}, width, height, true);
+
+	for (int l = 0; l < resolution; l++) {
+		vector<vector<double> > values(height, vector<double>(width));
+		for (int i = 0; i < height; i++) {
+			for (int j = 0; j < width; j++) {
+				values[i][j] = levels[i][j][l];
+			}
+		}
+
+		cv::imwrite(filenames[l], GenerateImageNegative(values));
+	}
+}
+
+/// <summary>
+/// Terrain of the second teaser evaluated with the scalar type T
+/// </summary>
+template<typename T>
+vector<vector<double> > PrecisionTerrain(int width, int height, int seed)
+{
+	typedef PerlinControlFunction ControlFunctionType;
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+
+	const double eps = 0.25;
+	const int resolution = 2;
+	const double displacement = 0.075;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 0.5;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(4.0, 4.0);
+	const Point2D controlFunctionTopLeft(-0.2, -0.5);
+	const Point2D controlFunctionBottomRight(1.40, 0.7);
+
+	const Noise<ControlFunctionType, T> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, false, false, false);
+
+	return EvaluateTerrain(noise, width, height);
+}
+
+/// <summary>
+/// Segments of the Lichtenberg figure showing the effect of parameters evaluated with the scalar type T
+/// </summary>
+template<typename T>
+vector<vector<double> > PrecisionLichtenbergFigure(int width, int height, int seed)
+{
+	typedef LichtenbergControlFunction ControlFunctionType;
+	unique_ptr<ControlFunctionType> controlFunction(make_unique<ControlFunctionType>());
+
+	const double eps = 0.25;
+	const int resolution = 3;
+	const double displacement = 0.05;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 1.0;
+	const double noiseAmplitudeProportion = 0.0;
+	const Point2D noiseTopLeft(-2.0, -2.0);
+	const Point2D noiseBottomRight(1.0, 1.0);
+	const Point2D controlFunctionTopLeft(-1.0, -1.0);
+	const Point2D controlFunctionBottomRight(1.0, 1.0);
+
+	const Noise<ControlFunctionType, T> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
+
+	return EvaluateLichtenbergFigure(noise, width, height);
+}
+
+/// <summary>
+/// Display the maximum and mean absolute errors of values compared to reference values
+/// </summary>
+void DisplayPrecisionError(const string& name, const vector<vector<double> >& reference, const vector<vector<double> >& values)
+{
+	double maxError = 0.0;
+	double sumError = 0.0;
+	int count = 0;
+
+	for (unsigned int i = 0; i < reference.size(); i++)
+	{
+		for (unsigned int j = 0; j < reference[i].size(); j++)
+		{
+			const double error = std::abs(values[i][j] - reference[i][j]);
+			maxError = std::max(maxError, error);
+			sumError += error;
+			count++;
+		}
+	}
+
+	std::cout << name << ": maximum error " << std::scientific << maxError << ", mean error " << sumError / count << std::defaultfloat << std::endl;
+}
+
+void PrecisionErrorReport(int width, int height, int seed)
+{
+	std::cout << "Terrain in double precision" << std::endl;
+	const auto terrainReference = PrecisionTerrain<double>(width, height, seed);
+	std::cout << "Terrain in single precision" << std::endl;
+	const auto terrain = PrecisionTerrain<float>(width, height, seed);
+	DisplayPrecisionError("Terrain", terrainReference, terrain);
+
+	std::cout << "Lichtenberg figure in double precision" << std::endl;
+	const auto lichtenbergReference = PrecisionLichtenbergFigure<double>(width, height, seed);
+	std::cout << "Lichtenberg figure in single precision" << std::endl;
+	const auto lichtenberg = PrecisionLichtenbergFigure<float>(width, height, seed);
+	DisplayPrecisionError("Lichtenberg figure", lichtenbergReference, lichtenberg);
+}
+
+bool PerlinBatchReport()
+{
+	vector<double> x;
+	vector<double> y;
+
+	// Negative and positive coordinates, around the 256 periodicity of the permutation
+	mt19937_64 generator(0);
+	uniform_real_distribution<double> distribution(-300.0, 300.0);
+	for (int k = 0; k < 997; k++) {
+		x.push_back(distribution(generator));
+		y.push_back(distribution(generator));
+	}
+
+	// Integer coordinates, where the point is a corner of its cell
+	for (int k = -257; k <= 257; k += 3) {
+		x.push_back(double(k));
+		y.push_back(double(-k / 2));
+	}
+
+	// Large coordinates, with and without a fractional part
+	const double large[] = { 1e8, -1e8, 1e8 + 0.25, -1e8 - 0.75, 123456789.5, -98765432.125 };
+	for (const double a : large) {
+		for (const double b : large) {
+			x.push_back(a);
+			y.push_back(b);
+		}
+	}
+
+	// Batches of all the sizes modulo 4, starting at all the offsets modulo 4
+	int differences = 0;
+	int derivativeDifferences = 0;
+	for (size_t offset = 0; offset < 4; offset++) {
+		for (size_t n = x.size() - offset - 3; n <= x.size() - offset; n++) {
+			vector<double> batch(n);
+			Perlin(x.data() + offset, y.data() + offset, batch.data(), n);
+
+			vector<double> batchWithDerivatives(n);
+			vector<double> batchDx(n);
+			vector<double> batchDy(n);
+			Perlin(x.data() + offset, y.data() + offset, batchWithDerivatives.data(), batchDx.data(), batchDy.data(), n);
+
+			for (size_t k = 0; k < n; k++) {
+				if (batch[k] != Perlin(x[offset + k], y[offset + k])) {
+					differences++;
+				}
+
+				double dx, dy;
+				const double value = Perlin(x[offset + k], y[offset + k], dx, dy);
+				if (batchWithDerivatives[k] != value || batchDx[k] != dx || batchDy[k] != dy) {
+					derivativeDifferences++;
+				}
+			}
+		}
+	}
+
+	std::cout << "Perlin noise in batches: " << differences << " values different from the scalar evaluation" << std::endl;
+	std::cout << "Perlin noise with derivatives in batches: " << derivativeDifferences << " values different from the scalar evaluation" << std::endl;
+
+	return differences == 0 && derivativeDifferences == 0;
+}
+
+bool TerrainSeedsReport()
+{
+	typedef PerlinControlFunction ControlFunctionType;
+
+	const double eps = 0.25;
+	const double displacement = 0.075;
+	const int primitivesResolutionSteps = 3;
+	const double slopePower = 0.5;
+	const double noiseAmplitudeProportion = 0.05;
+	const Point2D noiseTopLeft(0.0, 0.0);
+	const Point2D noiseBottomRight(4.0, 4.0);
+	const Point2D controlFunctionTopLeft(-0.2, -0.5);
+	const Point2D controlFunctionBottomRight(1.4, 0.7);
+
+	const int size = 32;
+
+	// The river graph also builds the cells around the domain, which the points of the domain never build alone
+	int invalidTerrains = 0;
+	for (const RandomGeneratorType randomGeneratorType : { RandomGeneratorType::MersenneTwister, RandomGeneratorType::CounterBased }) {
+		for (int resolution = 2; resolution <= 3; resolution++) {
+			for (int seed = 0; seed < 16; seed++) {
+				const Noise<ControlFunctionType> noise(make_unique<ControlFunctionType>(), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, false, false, false, false, true, randomGeneratorType);
+
+				vector<double> distances;
+				noise.evaluateDistanceRaster(size, size, distances);
+
+				bool valid = true;
+				for (int i = 0; i < size; i++) {
+					for (int j = 0; j < size; j++) {
+						const double x = lerp(noiseTopLeft.x, noiseBottomRight.x, (j + 0.5) / size);
+						const double y = lerp(noiseTopLeft.y, noiseBottomRight.y, (i + 0.5) / size);
+						valid = valid && std::isfinite(noise.evaluateTerrain(x, y)) && !std::isnan(distances[i * size + j]);
+					}
+				}
+
+				if (!valid) {
+					invalidTerrains++;
+				}
+			}
+		}
+	}
+
+	std::cout << "Terrains over the seeds: " << invalidTerrains << " terrains with invalid values" << std::endl;
+
+	return invalidTerrains == 0;
+}
+
 double PerformanceTest(int width, int height, const std::string& filename)
 {
 	typedef LichtenbergControlFunction ControlFunctionType;
@@ -715,11 +969,13 @@ double PerformanceTest(int width, int height, const std::string& filename)
 	const Point2D controlFunctionTopLeft(-1.0, -1.0);
 	const Point2D controlFunctionBottomRight(1.0, 1.0);
 
-	const Noise<ControlFunctionType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
+	// The displayed outputs are fixed at compile time, the others are not evaluated
+	typedef StaticDisplay<true, false, true, false, false> DisplayType;
+	const Noise<ControlFunctionType, double, DisplayType> noise(move(controlFunction), noiseTopLeft, noiseBottomRight, controlFunctionTopLeft, controlFunctionBottomRight, seed, eps, resolution, displacement, primitivesResolutionSteps, slopePower, noiseAmplitudeProportion, true, false, true, false, false);
 
 	// Measure execution time
 	const auto startTime = chrono::high_resolution_clock::now();
-	const auto result = EvaluateLichtenbergFigureWithoutProgress(noise, noiseTopLeft, noiseBottomRight, width, height);
+	const auto result = EvaluateLichtenbergFigureWithoutProgress(noise, width, height);
 	const auto endTime = chrono::high_resolution_clock::now();
 
 	// Save the image for comparison to a reference
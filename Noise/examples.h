@@ -2,6 +2,7 @@
 #define EXAMPLES_H
 
 #include <string>
+#include <vector>
 
 void PerlinControlFunctionImage(int width, int height, const std::string& filename);
 
@@ -13,23 +14,59 @@ void SmallAmplificationImage(int width, int height, int seed, const std::string&
 
 void BigAmplificationImage(int width, int height, int seed, const std::string& input, const std::string& filename);
 
-void EffectBetaTerrainImage(int width, int height, int seed, double beta, const std::string& filename);
-
-void TeaserFirstDistanceImage(int width, int height, int seed, const std::string& filename);
-
-void TeaserFirstTerrainImage(int width, int height, int seed, const std::string& filename);
-
-void TeaserSecondDistanceImage(int width, int height, int seed, const std::string& filename);
+/**
+ * \brief Amplify a terrain read from a tiled file, so that only the tiles that are evaluated are loaded.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the terrain
+ * \param input Image of the terrain, converted to the tiled file
+ * \param tiledInput Tiled file created from the image
+ * \param filename File in which the result is saved
+ */
+void TiledAmplificationImage(int width, int height, int seed, const std::string& input, const std::string& tiledInput, const std::string& filename);
 
-void TeaserSecondTerrainImage(int width, int height, int seed, const std::string& filename);
+void EffectBetaTerrainImage(int width, int height, int seed, double beta, const std::string& filename);
 
-void TeaserThirdDistanceImage(int width, int height, int seed, const std::string& filename);
+/**
+ * \brief Generate the distance to the segments and the terrain of the first teaser in a single evaluation.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the terrain
+ * \param distanceFilename File in which the distance is saved
+ * \param terrainFilename File in which the terrain is saved
+ */
+void TeaserFirstImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename);
 
-void TeaserThirdTerrainImage(int width, int height, int seed, const std::string& filename);
+/**
+ * \brief Generate the distance to the segments and the terrain of the second teaser in a single evaluation.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the terrain
+ * \param distanceFilename File in which the distance is saved
+ * \param terrainFilename File in which the terrain is saved
+ */
+void TeaserSecondImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename);
 
-void SketchSegmentsImage(int width, int height, int seed, const std::string& input, const std::string& filename);
+/**
+ * \brief Generate the distance to the segments and the terrain of the third teaser in a single evaluation.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the terrain
+ * \param distanceFilename File in which the distance is saved
+ * \param terrainFilename File in which the terrain is saved
+ */
+void TeaserThirdImages(int width, int height, int seed, const std::string& distanceFilename, const std::string& terrainFilename);
 
-void SketchTerrainImage(int width, int height, int seed, const std::string& input, const std::string& filename);
+/**
+ * \brief Generate the segments and the terrain amplified from a sketch in a single evaluation.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the terrain
+ * \param input Image of the sketch
+ * \param segmentsFilename File in which the segments are saved
+ * \param terrainFilename File in which the terrain is saved
+ */
+void SketchImages(int width, int height, int seed, const std::string& input, const std::string& segmentsFilename, const std::string& terrainFilename);
 
 void EvaluationTerrainImage(int width, int height, int seed, const std::string& filename);
 
@@ -39,10 +76,49 @@ void PerlinPlaneSegmentsImage(int width, int height, int seed, const std::string
 
 void PerlinPlaneTerrainImage(int width, int height, int seed, const std::string& filename);
 
+/**
+ * \brief Draw the Lichtenberg figure with anti aliasing, directly at the resolution of the image.
+ */
 void LichtenbergFigureImage(int width, int height, int seed, const std::string& filename);
 
 void EffectParametersImage(int width, int height, int seed, int resolution, double eps, double displacement, const std::string& filename);
 
+/**
+ * \brief Generate the Lichtenberg figures of the parameters effect for the resolutions 1 to the number of files in a single evaluation.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the figures
+ * \param eps Epsilon of the figures
+ * \param displacement Displacement of the segments of the figures
+ * \param filenames Files in which the figures with 1, 2, ... levels are saved
+ */
+void EffectResolutionImages(int width, int height, int seed, double eps, double displacement, const std::vector<std::string>& filenames);
+
+/**
+ * \brief Compare figures evaluated in single precision to the same figures in double precision.
+ * Display the maximum and mean absolute errors of a terrain and of a Lichtenberg figure.
+ * \param width Resolution in the width axis
+ * \param height Resolution in the height axis
+ * \param seed Seed of the figures
+ */
+void PrecisionErrorReport(int width, int height, int seed);
+
+/**
+ * \brief Compare the batch evaluations of Perlin noise, with and without derivatives, to the scalar ones, point by point.
+ * The points have negative, integer and large coordinates, and their number is not a multiple of the batch width.
+ * Display the number of points whose values differ.
+ * \return True if the values are identical at all the points
+ */
+bool PerlinBatchReport();
+
+/**
+ * \brief Evaluate terrains with a river graph for several seeds, random generators and resolutions.
+ * The graph also builds the cells around the domain, where the connections of the points may be degenerate.
+ * Display the number of terrains with non finite values, the assertions of debug builds also check the segments of the graph.
+ * \return True if all the terrains are valid
+ */
+bool TerrainSeedsReport();
+
 /**
  * \brief Measure the time in ms taken to generate Lichtenberg figure.
  * #!/bin/bash
@@ -7,12 +7,30 @@ using namespace std;
 
 int main(int argc, char* argv[])
 {
+	std::cout << "Consistency of the batch evaluation of Perlin noise" << std::endl;
+	if (!PerlinBatchReport())
+	{
+		return 1;
+	}
+
+	std::cout << "Consistency of the terrains over the seeds" << std::endl;
+	if (!TerrainSeedsReport())
+	{
+		return 1;
+	}
+
 	std::cout << "Performance Test" << std::endl;
 	const int PERFORMANCE_WIDTH = 1024;
 	const int PERFORMANCE_HEIGHT = 1024;
 	const string PERFORMANCE_OUTPUT = "performance_test.png";
 	std::cout << std::fixed << std::setprecision(2) << PerformanceTest(PERFORMANCE_WIDTH, PERFORMANCE_HEIGHT, PERFORMANCE_OUTPUT) << std::endl;
 	
+	std::cout << "Error of the single precision evaluation" << std::endl;
+	const int PRECISION_WIDTH = 512;
+	const int PRECISION_HEIGHT = 512;
+	const int PRECISION_SEED = 0;
+	PrecisionErrorReport(PRECISION_WIDTH, PRECISION_HEIGHT, PRECISION_SEED);
+
 	const int CONTROL_FUNCTION_WIDTH = 512;
 	const int CONTROL_FUNCTION_HEIGHT = 512;
 	
@@ -43,6 +61,11 @@ int main(int argc, char* argv[])
 	const string BIG_AMP_INPUT = "../Images/amplification_big.png";
 	const string BIG_AMP_OUTPUT = "amplification_big_result.png";
 	BigAmplificationImage(BIG_AMP_WIDTH, BIG_AMP_HEIGHT, BIG_AMP_SEED, BIG_AMP_INPUT, BIG_AMP_OUTPUT);
+
+	std::cout << "Amplification of a big terrain read from a tiled file" << std::endl;
+	const string TILED_AMP_INPUT = "amplification_big.tiled";
+	const string TILED_AMP_OUTPUT = "amplification_tiled_result.png";
+	TiledAmplificationImage(BIG_AMP_WIDTH, BIG_AMP_HEIGHT, BIG_AMP_SEED, BIG_AMP_INPUT, TILED_AMP_INPUT, TILED_AMP_OUTPUT);
 	
 	std::cout << "Procedural generation of a small terrain to show the effect of beta (slope power)" << std::endl;
 	const int BETA_TERRAIN_WIDTH = 512;
@@ -68,8 +91,7 @@ int main(int argc, char* argv[])
 	const int TEASER_1_TERRAIN_SEED = 0;
 	const string TEASER_1_DISTANCE_OUTPUT = "teaser_1_distance.png";
 	const string TEASER_1_TERRAIN_OUTPUT = "teaser_1_terrain.png";
-	TeaserFirstDistanceImage(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_DISTANCE_OUTPUT);
-	TeaserFirstTerrainImage(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_TERRAIN_OUTPUT);
+	TeaserFirstImages(TEASER_1_TERRAIN_WIDTH, TEASER_1_TERRAIN_HEIGHT, TEASER_1_TERRAIN_SEED, TEASER_1_DISTANCE_OUTPUT, TEASER_1_TERRAIN_OUTPUT);
 
 	std::cout << "Procedural generation of the teaser 2 terrain" << std::endl;
 	const int TEASER_2_TERRAIN_WIDTH = 768;
@@ -77,8 +99,7 @@ int main(int argc, char* argv[])
 	const int TEASER_2_TERRAIN_SEED = 0;
 	const string TEASER_2_DISTANCE_OUTPUT = "teaser_2_distance.png";
 	const string TEASER_2_TERRAIN_OUTPUT = "teaser_2_terrain.png";
-	TeaserSecondDistanceImage(TEASER_2_TERRAIN_WIDTH, TEASER_2_TERRAIN_HEIGHT, TEASER_2_TERRAIN_SEED, TEASER_2_DISTANCE_OUTPUT);
-	TeaserSecondTerrainImage(TEASER_2_TERRAIN_WIDTH, TEASER_2_TERRAIN_HEIGHT, TEASER_2_TERRAIN_SEED, TEASER_2_TERRAIN_OUTPUT);
+	TeaserSecondImages(TEASER_2_TERRAIN_WIDTH, TEASER_2_TERRAIN_HEIGHT, TEASER_2_TERRAIN_SEED, TEASER_2_DISTANCE_OUTPUT, TEASER_2_TERRAIN_OUTPUT);
 
 	std::cout << "Procedural generation of the teaser 3 terrain" << std::endl;
 	const int TEASER_3_TERRAIN_WIDTH = 1024;
@@ -86,8 +107,7 @@ int main(int argc, char* argv[])
 	const int TEASER_3_TERRAIN_SEED = 0;
 	const string TEASER_3_DISTANCE_OUTPUT = "teaser_3_distance.png";
 	const string TEASER_3_TERRAIN_OUTPUT = "teaser_3_terrain.png";
-	TeaserThirdDistanceImage(TEASER_3_TERRAIN_WIDTH, TEASER_3_TERRAIN_HEIGHT, TEASER_3_TERRAIN_SEED, TEASER_3_DISTANCE_OUTPUT);
-	TeaserThirdTerrainImage(TEASER_3_TERRAIN_WIDTH, TEASER_3_TERRAIN_HEIGHT, TEASER_3_TERRAIN_SEED, TEASER_3_TERRAIN_OUTPUT);
+	TeaserThirdImages(TEASER_3_TERRAIN_WIDTH, TEASER_3_TERRAIN_HEIGHT, TEASER_3_TERRAIN_SEED, TEASER_3_DISTANCE_OUTPUT, TEASER_3_TERRAIN_OUTPUT);
 
 	std::cout << "Procedural generation of a set of medium terrains for evaluation" << std::endl;
 	const int EVALUATION_TERRAIN_WIDTH = 512;
@@ -114,8 +134,7 @@ int main(int argc, char* argv[])
 	const string SKETCH_INPUT = "../Images/sketch_control_function.png";
 	const string SKETCH_SEGMENTS_OUTPUT = "sketch_segments.png";
 	const string SKETCH_TERRAIN_OUTPUT = "sketch_terrain.png";
-	SketchSegmentsImage(SKETCH_TERRAIN_WIDTH, SKETCH_TERRAIN_HEIGHT, SKETCH_TERRAIN_SEED, SKETCH_INPUT, SKETCH_SEGMENTS_OUTPUT);
-	SketchTerrainImage(SKETCH_TERRAIN_WIDTH, SKETCH_TERRAIN_HEIGHT, SKETCH_TERRAIN_SEED, SKETCH_INPUT, SKETCH_TERRAIN_OUTPUT);
+	SketchImages(SKETCH_TERRAIN_WIDTH, SKETCH_TERRAIN_HEIGHT, SKETCH_TERRAIN_SEED, SKETCH_INPUT, SKETCH_SEGMENTS_OUTPUT, SKETCH_TERRAIN_OUTPUT);
 	
 	std::cout << "Segments and terrain with the perlin plane control function" << std::endl;
 	const int PERLIN_PLANE_WIDTH = 512;
@@ -134,8 +153,8 @@ int main(int argc, char* argv[])
 	PerlinSegmentsImage(PERLIN_WIDTH, PERLIN_HEIGHT, PERLIN_SEED, PERLIN_OUTPUT);
 	
 	std::cout << "Procedural generation of a Lichtenberg figure" << std::endl;
-	const int LICHTENBERG_WIDTH = 8192;
-	const int LICHTENBERG_HEIGHT = 8192;
+	const int LICHTENBERG_WIDTH = 1024;
+	const int LICHTENBERG_HEIGHT = 1024;
 	const int LICHTENBERG_SEED = 33058;
 	const string LICHTENBERG_OUTPUT = "lichtenberg.png";
 	LichtenbergFigureImage(LICHTENBERG_WIDTH, LICHTENBERG_HEIGHT, LICHTENBERG_SEED, LICHTENBERG_OUTPUT);
@@ -160,15 +179,17 @@ int main(int argc, char* argv[])
 
 		EffectParametersImage(EFFECT_WIDTH, EFFECT_HEIGHT, seed, EFFECT_DEFAULT_RESOLUTION, EFFECT_DEFAULT_EPSILON, EFFECT_DEFAULT_DELTA, filename);
 	}
-	// Vary the resolution
+	// Vary the resolution, all the resolutions are evaluated at once
+	vector<string> resolutionFilenames;
 	for (int resolution = 1; resolution <= 5; resolution++)
 	{
 		const string filename = EFFECT_OUTPUT + "resolution_" + std::to_string(resolution) + EFFECT_EXTENTION;
 
 		std::cout << "File: " << filename << std::endl;
 
-		EffectParametersImage(EFFECT_WIDTH, EFFECT_HEIGHT, EFFECT_DEFAULT_SEED, resolution, EFFECT_DEFAULT_EPSILON, EFFECT_DEFAULT_DELTA, filename);
+		resolutionFilenames.push_back(filename);
 	}
+	EffectResolutionImages(EFFECT_WIDTH, EFFECT_HEIGHT, EFFECT_DEFAULT_SEED, EFFECT_DEFAULT_EPSILON, EFFECT_DEFAULT_DELTA, resolutionFilenames);
 	// Vary the epsilon
 	for (int e = 0; e <= 4; e++)
 	{
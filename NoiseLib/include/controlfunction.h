@@ -17,6 +17,15 @@ public:
 		return static_cast<const Implementation*>(this)->EvaluateImpl(x, y);
 	}
 
+	/// <summary>
+	/// Evaluate the function in (x, y) for an area of size footprint around the point.
+	/// Implementations can filter the function at the scale of the footprint.
+	/// </summary>
+	double evaluate(double x, double y, double footprint) const
+	{
+		return static_cast<const Implementation*>(this)->EvaluateFilteredImpl(x, y, footprint);
+	}
+
 	/// <summary>
 	/// Check whether a point is inside the domain of the function
 	/// </summary>
@@ -35,6 +44,42 @@ public:
 		return static_cast<const Implementation*>(this)->DistToDomainImpl(x, y);
 	}
 
+	/// <summary>
+	/// Evaluate the function in n points (x[k], y[k])
+	/// </summary>
+	/// <param name="values">Values of the function at the n points</param>
+	void evaluateBatch(const double* x, const double* y, double* values, int n) const
+	{
+		static_cast<const Implementation*>(this)->EvaluateBatchImpl(x, y, values, n);
+	}
+
+	/// <summary>
+	/// Evaluate the function in n points (x[k], y[k]) for areas of size footprint around them
+	/// </summary>
+	/// <param name="values">Values of the function at the n points</param>
+	void evaluateBatch(const double* x, const double* y, double* values, int n, double footprint) const
+	{
+		static_cast<const Implementation*>(this)->EvaluateFilteredBatchImpl(x, y, values, n, footprint);
+	}
+
+	/// <summary>
+	/// Check whether n points (x[k], y[k]) are inside the domain of the function
+	/// </summary>
+	/// <param name="inside">True for the points inside the domain</param>
+	void insideDomainBatch(const double* x, const double* y, bool* inside, int n) const
+	{
+		static_cast<const Implementation*>(this)->InsideDomainBatchImpl(x, y, inside, n);
+	}
+
+	/// <summary>
+	/// Announce that the function will be evaluated in the region [xMin, xMax] x [yMin, yMax]
+	/// with a footprint, so that implementations can load the data of the region in advance
+	/// </summary>
+	void prefetch(double xMin, double yMin, double xMax, double yMax, double footprint) const
+	{
+		static_cast<const Implementation*>(this)->PrefetchImpl(xMin, yMin, xMax, yMax, footprint);
+	}
+
 	/// <summary>
 	/// Return the minimum value of the control function
 	/// </summary>
@@ -52,6 +97,41 @@ public:
 	{
 		return static_cast<const Implementation*>(this)->MaximumImpl();
 	}
+
+protected:
+	// Default batch evaluation, point by point.
+	// Implementations can hide these functions with faster versions.
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			values[k] = evaluate(x[k], y[k]);
+		}
+	}
+
+	// By default, the footprint is ignored and the function is not filtered
+	double EvaluateFilteredImpl(double x, double y, double footprint) const
+	{
+		return evaluate(x, y);
+	}
+
+	void EvaluateFilteredBatchImpl(const double* x, const double* y, double* values, int n, double footprint) const
+	{
+		evaluateBatch(x, y, values, n);
+	}
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			inside[k] = insideDomain(x[k], y[k]);
+		}
+	}
+
+	// By default, the function has no data to load
+	void PrefetchImpl(double xMin, double yMin, double xMax, double yMax, double footprint) const
+	{
+	}
 };
 
 #endif // CONTROLFUNCTION_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef CONTROLFUNCTIONCACHE_H
+#define CONTROLFUNCTIONCACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "math2d.h"
+
+/// <summary>
+/// Bounded cache of the elevation and of the domain membership of the control function
+/// at the points of the cells of all levels.
+/// Entries are keyed by the points themselves, so a point of a coarser level reused
+/// in the neighborhood of a finer cell hits the entry of its own cell. Each point maps
+/// to one slot, and a new point replaces the one stored in its slot.
+/// The cache is thread-safe. It can only be shared by noises with the same control
+/// function and the same noise and control function domains.
+/// </summary>
+class ControlFunctionCache
+{
+public:
+	static const size_t DEFAULT_CAPACITY = 1 << 16;
+
+	struct Statistics
+	{
+		uint64_t hits;
+		uint64_t misses;
+
+		double hitRate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+	};
+
+	/// <summary>
+	/// Create an empty cache
+	/// </summary>
+	/// <param name="capacity">Maximum number of points in the cache, rounded up to a power of two</param>
+	explicit ControlFunctionCache(size_t capacity = DEFAULT_CAPACITY);
+
+	size_t capacity() const { return m_entries.size(); }
+
+	/// <summary>
+	/// Find the elevation of the control function at a point
+	/// </summary>
+	/// <param name="point">Point in the noise domain</param>
+	/// <param name="footprint">Footprint with which the control function was evaluated</param>
+	/// <param name="elevation">Elevation at the point, set only if it is in the cache</param>
+	/// <returns>True if the elevation is in the cache</returns>
+	bool findElevation(const Point2D& point, double footprint, double& elevation) const;
+
+	void storeElevation(const Point2D& point, double footprint, double elevation);
+
+	/// <summary>
+	/// Find if a point is in the domain of the control function
+	/// </summary>
+	/// <param name="point">Point in the noise domain</param>
+	/// <param name="inside">True if the point is in the domain, set only if it is in the cache</param>
+	/// <returns>True if the domain membership is in the cache</returns>
+	bool findInsideDomain(const Point2D& point, bool& inside) const;
+
+	void storeInsideDomain(const Point2D& point, bool inside);
+
+	/// <summary>
+	/// Number of lookups that found or missed their value since the cache was created or cleared
+	/// </summary>
+	Statistics statistics() const;
+
+	void clear();
+
+private:
+	static const size_t MUTEX_COUNT = 64;
+
+	struct Entry
+	{
+		Point2D point;
+		double footprint = 0.0;
+		double elevation = 0.0;
+		bool inside = false;
+		bool hasElevation = false;
+		bool hasInside = false;
+	};
+
+	size_t Slot(const Point2D& point) const;
+
+	std::mutex& SlotMutex(size_t slot) const;
+
+	Entry& ClaimSlot(size_t slot, const Point2D& point);
+
+	std::vector<Entry> m_entries;
+
+	// Slots are protected by a fixed number of mutexes, slot i by mutex i % MUTEX_COUNT
+	mutable std::array<std::mutex, MUTEX_COUNT> m_mutexes;
+
+	mutable std::atomic<uint64_t> m_hits;
+	mutable std::atomic<uint64_t> m_misses;
+};
+
+#endif // CONTROLFUNCTIONCACHE_H
@@ -0,0 +1,60 @@
+#ifndef DISPLAYPOLICY_H
+#define DISPLAYPOLICY_H
+
+#include <cassert>
+
+/// <summary>
+/// Display policy of a noise whose outputs are chosen at runtime, when the noise is constructed.
+/// </summary>
+class RuntimeDisplay
+{
+public:
+	RuntimeDisplay(bool displayFunction, bool displayPoints, bool displaySegments, bool displayGrid, bool displayDistance) :
+		m_displayFunction(displayFunction),
+		m_displayPoints(displayPoints),
+		m_displaySegments(displaySegments),
+		m_displayGrid(displayGrid),
+		m_displayDistance(displayDistance)
+	{
+	}
+
+	bool function() const { return m_displayFunction; }
+	bool points() const { return m_displayPoints; }
+	bool segments() const { return m_displaySegments; }
+	bool grid() const { return m_displayGrid; }
+	bool distance() const { return m_displayDistance; }
+
+private:
+	const bool m_displayFunction;
+	const bool m_displayPoints;
+	const bool m_displaySegments;
+	const bool m_displayGrid;
+	const bool m_displayDistance;
+};
+
+/// <summary>
+/// Display policy of a noise whose outputs are known at compile time.
+/// The evaluation of the outputs that are not displayed is removed from the generated code.
+/// </summary>
+template <bool DisplayFunction, bool DisplayPoints, bool DisplaySegments, bool DisplayGrid, bool DisplayDistance>
+class StaticDisplay
+{
+public:
+	StaticDisplay(bool displayFunction, bool displayPoints, bool displaySegments, bool displayGrid, bool displayDistance)
+	{
+		// The outputs requested at construction must be the ones of the policy
+		assert(displayFunction == DisplayFunction);
+		assert(displayPoints == DisplayPoints);
+		assert(displaySegments == DisplaySegments);
+		assert(displayGrid == DisplayGrid);
+		assert(displayDistance == DisplayDistance);
+	}
+
+	static constexpr bool function() { return DisplayFunction; }
+	static constexpr bool points() { return DisplayPoints; }
+	static constexpr bool segments() { return DisplaySegments; }
+	static constexpr bool grid() { return DisplayGrid; }
+	static constexpr bool distance() { return DisplayDistance; }
+};
+
+#endif // DISPLAYPOLICY_H
@@ -0,0 +1,19 @@
+#ifndef DISTANCETRANSFORM_H
+#define DISTANCETRANSFORM_H
+
+#include <vector>
+
+/// <summary>
+/// Squared Euclidean distance transform of a sampled function, in linear time (Felzenszwalb and Huttenlocher).
+/// Each value becomes the minimum over all samples q of values[q] + |p - q|^2, where |p - q| is measured
+/// with the spacing of the samples. With 0 at the seeds and infinity elsewhere, values become the squared
+/// distances to the nearest seed.
+/// </summary>
+/// <param name="values">Values of the samples, row by row, replaced by the transform</param>
+/// <param name="width">Number of columns</param>
+/// <param name="height">Number of rows</param>
+/// <param name="spacingX">Distance between two columns</param>
+/// <param name="spacingY">Distance between two rows</param>
+void squaredDistanceTransform(std::vector<double>& values, int width, int height, double spacingX, double spacingY);
+
+#endif // DISTANCETRANSFORM_H
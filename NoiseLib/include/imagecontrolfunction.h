@@ -2,6 +2,7 @@
 #define IMAGECONTROLFUNCTION_H
 
 #include <utility>
+#include <vector>
 #include <cassert>
 
 #include <opencv2/core/core.hpp>
@@ -12,18 +13,20 @@
 #include "math2d.h"
 #include "utils.h"
 
+/// <summary>
+/// Control function given by a grayscale image of type CV_8U or CV_16U, interpolated with a bicubic filter.
+/// The image is decoded once in a raster of values between 0 and 1, with borders so that
+/// the 4x4 texels of the filter are always in the raster.
+/// A pyramid of rasters, each one half the size of the previous one, is built from the image.
+/// Evaluations with a footprint read the coarsest raster whose texels are not larger than
+/// the footprint, so that coarse levels of the noise read small rasters without aliasing.
+/// </summary>
 class ImageControlFunction : public ControlFunction<ImageControlFunction>
 {
 	friend class ControlFunction<ImageControlFunction>;
 
 public:
-	explicit ImageControlFunction(cv::Mat image) : m_image(std::move(image))
-	{
-		assert(image.data != nullptr);
-		assert(image.type() == CV_8U || image.type() == CV_16U);
-		assert(image.rows > 1);
-		assert(image.cols > 1);
-	}
+	explicit ImageControlFunction(const cv::Mat& image);
 
 protected:
 	double EvaluateImpl(double x, double y) const
@@ -31,7 +34,15 @@ protected:
 		x = std::clamp(x, 0.0, 1.0);
 		y = std::clamp(y, 0.0, 1.0);
 
-		return sample(y, x);
+		return sample(m_pyramid.front(), y, x);
+	}
+
+	double EvaluateFilteredImpl(double x, double y, double footprint) const
+	{
+		x = std::clamp(x, 0.0, 1.0);
+		y = std::clamp(y, 0.0, 1.0);
+
+		return sample(m_pyramid[PyramidLevel(footprint)], y, x);
 	}
 
 	bool InsideDomainImpl(double x, double y) const
@@ -39,6 +50,18 @@ protected:
 		return x >= 0.0 && x <= 1.0 && y >= 0.0 && y <= 1.0;
 	}
 
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const;
+
+	void EvaluateFilteredBatchImpl(const double* x, const double* y, double* values, int n, double footprint) const;
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			inside[k] = (x[k] >= 0.0) & (x[k] <= 1.0) & (y[k] >= 0.0) & (y[k] <= 1.0);
+		}
+	}
+
 	double DistToDomainImpl(double x, double y) const
 	{
 		if (InsideDomainImpl(x, y))
@@ -76,28 +99,67 @@ protected:
 	}
 
 private:
-	double get(int i, int j) const
+	// Texels added before the first and after the last row and column of the image
+	static const int BORDER_BEFORE = 1;
+	static const int BORDER_AFTER = 2;
+
+	// Rows of the raster start on multiples of this number of values
+	static const int ROW_ALIGNMENT = 8;
+
+	/// <summary>
+	/// Values of an image between 0 and 1, with clamped borders
+	/// </summary>
+	class Raster
 	{
-		double value = 0.0;
+	public:
+		Raster(int rows, int cols);
 
-		switch (m_image.type())
-		{
-		case CV_8U:
-			// Remap the value between min_value and min_value
-			value = double(m_image.at<uint8_t>(i, j)) / std::numeric_limits<uint8_t>::max();
-			break;
-		case CV_16U:
-			// Remap the value between min_value and min_value
-			value = double(m_image.at<uint16_t>(i, j)) / std::numeric_limits<uint16_t>::max();
-			break;
-		}
+		int rows() const { return m_rows; }
+		int cols() const { return m_cols; }
+		int stride() const { return m_stride; }
 
-		return value;
-	}
+		// Largest distance between two texels in the [0, 1] x [0, 1] domain
+		double texelSize() const { return std::max(1.0 / (m_rows - 1), 1.0 / (m_cols - 1)); }
+
+		double get(int i, int j) const { return *texel(i, j); }
+
+		double& at(int i, int j) { return m_texels[Index(i, j)]; }
+
+		// Pointer to a texel, i and j can be in the borders
+		const double* texel(int i, int j) const { return &m_texels[Index(i, j)]; }
+
+		// Copy the first and last rows and columns in the borders
+		void clampBorders();
+
+	private:
+		size_t Index(int i, int j) const { return m_origin + size_t(i + BORDER_BEFORE) * m_stride + j + BORDER_BEFORE; }
+
+		int m_rows;
+		int m_cols;
+
+		// Number of values between two rows of the raster
+		int m_stride;
+
+		// Index of the first value of the raster, aligned on ROW_ALIGNMENT values
+		size_t m_origin;
+
+		std::vector<double> m_texels;
+	};
+
+	// Decode an image whose pixels are of type P
+	template <typename P>
+	static Raster Decode(const cv::Mat& image);
+
+	// Average the texels of a raster 2 by 2
+	static Raster Downsample(const Raster& raster);
+
+	// Index of the coarsest raster of the pyramid whose texels are not larger than the footprint
+	size_t PyramidLevel(double footprint) const;
 
-	double sample(double ri, double rj) const;
+	static double sample(const Raster& raster, double ri, double rj);
 
-	const cv::Mat m_image;
+	// Rasters from the full resolution image to a 2x2 image
+	std::vector<Raster> m_pyramid;
 };
 
 #endif // IMAGECONTROLFUNCTION_H
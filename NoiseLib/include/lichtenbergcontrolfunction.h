@@ -25,6 +25,24 @@ protected:
 		return x >= -1.0 && x <= 1.0 && y >= -1.0 && y <= 1.0;
 	}
 
+	// Branchless versions of EvaluateImpl and InsideDomainImpl, so that the loops are vectorized
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			const double value = x[k] * x[k] + (y[k] + 1.0) * (y[k] + 1.0);
+			values[k] = InsideDomainImpl(x[k], y[k]) ? value : 16.0;
+		}
+	}
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			inside[k] = (x[k] >= -1.0) & (x[k] <= 1.0) & (y[k] >= -1.0) & (y[k] <= 1.0);
+		}
+	}
+
 	double DistToDomainImpl(double x, double y) const
 	{
 		if (InsideDomainImpl(x, y))
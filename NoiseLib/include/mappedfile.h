@@ -0,0 +1,48 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Read-only mapping of a whole file in memory.
+/// The pages of the file are only read when they are accessed.
+/// </summary>
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// <summary>
+	/// First byte of the file, nullptr if the file could not be mapped
+	/// </summary>
+	const uint8_t* data() const { return m_data; }
+
+	size_t size() const { return m_size; }
+
+	/// <summary>
+	/// Ask the system to read a range of the file before it is accessed, with madvise
+	/// on POSIX systems and PrefetchVirtualMemory on Windows. This is only a hint.
+	/// </summary>
+	/// <param name="offset">Offset of the first byte of the range</param>
+	/// <param name="size">Number of bytes in the range</param>
+	void prefetch(size_t offset, size_t size) const;
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+};
+
+#endif // MAPPEDFILE_H
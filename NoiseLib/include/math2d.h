@@ -8,254 +8,321 @@
 
 const double EPS = 1e-9;
 
-struct Point2D;
-struct Vec2D;
-struct Segment2D;
+template <typename T> struct Point2DT;
+template <typename T> struct Vec2DT;
+template <typename T> struct Segment2DT;
+
+// Geometry in double precision, used by default
+typedef Point2DT<double> Point2D;
+typedef Vec2DT<double> Vec2D;
+typedef Segment2DT<double> Segment2D;
 
 /*
  * Point in a 2D Space
  */
-struct Point2D
+template <typename T>
+struct Point2DT
 {
-	double x;
-	double y;
+	typedef T Scalar;
+
+	T x;
+	T y;
 
-	Point2D() : x(0.0), y(0.0) { }
+	Point2DT() : x(0.0), y(0.0) { }
 
-	Point2D(double _x, double _y) : x(_x), y(_y) { }
+	Point2DT(T _x, T _y) : x(_x), y(_y) { }
+
+	// Conversion from another precision
+	template <typename U>
+	explicit Point2DT(const Point2DT<U>& p) : x(T(p.x)), y(T(p.y)) { }
 
 	// Unary Point operators
-	Point2D& operator+=(const Point2D& p) { x += p.x; y += p.y; return *this; }
-	Point2D& operator-=(const Point2D& p) { x -= p.x; y -= p.y; return *this; }
+	Point2DT& operator+=(const Point2DT& p) { x += p.x; y += p.y; return *this; }
+	Point2DT& operator-=(const Point2DT& p) { x -= p.x; y -= p.y; return *this; }
 
 	// Unary Vector operators
-	Point2D& operator+=(const Vec2D& v);
-	Point2D& operator-=(const Vec2D& v);
+	Point2DT& operator+=(const Vec2DT<T>& v) { x += v.x; y += v.y; return *this; }
+	Point2DT& operator-=(const Vec2DT<T>& v) { x -= v.x; y -= v.y; return *this; }
 
 	// Scalar operators
-	Point2D& operator*=(double s) { x *= s; y *= s; return *this; }
-	Point2D& operator/=(double s) { x /= s; y /= s; return *this; }
-	
+	Point2DT& operator*=(T s) { x *= s; y *= s; return *this; }
+	Point2DT& operator/=(T s) { x /= s; y /= s; return *this; }
+
 	// Unary minus operator
-	Point2D operator-() const { return Point2D(-x, -y);	}
+	Point2DT operator-() const { return Point2DT(-x, -y);	}
 };
 
 // Comparison operators
-inline bool operator==(const Point2D& lhs, const Point2D& rhs) {
+template <typename T>
+inline bool operator==(const Point2DT<T>& lhs, const Point2DT<T>& rhs) {
 	return ((fabs(lhs.x - rhs.x) < EPS) && (fabs(lhs.y - rhs.y) < EPS));
 }
 
-inline bool operator!=(const Point2D& lhs, const Point2D& rhs) {
+template <typename T>
+inline bool operator!=(const Point2DT<T>& lhs, const Point2DT<T>& rhs) {
 	return !(lhs  == rhs);
 }
 
 // Binary Point operators
-inline Point2D operator+(const Point2D& a, const Point2D& b) {
-	return Point2D(a) += b;
+template <typename T>
+inline Point2DT<T> operator+(const Point2DT<T>& a, const Point2DT<T>& b) {
+	return Point2DT<T>(a) += b;
 }
 
-inline Point2D operator-(const Point2D& a, const Point2D& b) {
-	return Point2D(a) -= b;
+template <typename T>
+inline Point2DT<T> operator-(const Point2DT<T>& a, const Point2DT<T>& b) {
+	return Point2DT<T>(a) -= b;
 }
 
 // Binary Vector operators
-inline Point2D operator+(const Point2D& a, const Vec2D& v) {
-	return Point2D(a) += v;
+template <typename T>
+inline Point2DT<T> operator+(const Point2DT<T>& a, const Vec2DT<T>& v) {
+	return Point2DT<T>(a) += v;
 }
 
-inline Point2D operator-(const Point2D& a, const Vec2D& v) {
-	return Point2D(a) -= v;
+template <typename T>
+inline Point2DT<T> operator-(const Point2DT<T>& a, const Vec2DT<T>& v) {
+	return Point2DT<T>(a) -= v;
 }
 
 // Binary scalar operators
-inline Point2D operator*(const Point2D& a, double s) {
-	return Point2D(a) *= s;
+template <typename T>
+inline Point2DT<T> operator*(const Point2DT<T>& a, typename Point2DT<T>::Scalar s) {
+	return Point2DT<T>(a) *= s;
 }
 
-inline Point2D operator*(double s, const Point2D& a) {
-	return Point2D(a) *= s;
+template <typename T>
+inline Point2DT<T> operator*(typename Point2DT<T>::Scalar s, const Point2DT<T>& a) {
+	return Point2DT<T>(a) *= s;
 }
 
-inline Point2D operator/(const Point2D& a, double s) {
-	return Point2D(a) /= s;
+template <typename T>
+inline Point2DT<T> operator/(const Point2DT<T>& a, typename Point2DT<T>::Scalar s) {
+	return Point2DT<T>(a) /= s;
 }
 
 // Utility functions
-inline double dist_sq(const Point2D& lhs, const Point2D& rhs) {
+template <typename T>
+inline T dist_sq(const Point2DT<T>& lhs, const Point2DT<T>& rhs) {
 	return (lhs.x - rhs.x) * (lhs.x - rhs.x)
 		 + (lhs.y - rhs.y) * (lhs.y - rhs.y);
 }
 
-inline double dist(const Point2D& lhs, const Point2D& rhs) {
-	return sqrt(dist_sq(lhs, rhs));
+template <typename T>
+inline T dist(const Point2DT<T>& lhs, const Point2DT<T>& rhs) {
+	return std::sqrt(dist_sq(lhs, rhs));
 }
 
-inline double hypot(const Point2D& lhs, const Point2D& rhs) {
-	return hypot(lhs.x - rhs.x, lhs.y - rhs.y);
+template <typename T>
+inline T hypot(const Point2DT<T>& lhs, const Point2DT<T>& rhs) {
+	return std::hypot(lhs.x - rhs.x, lhs.y - rhs.y);
 }
 
-inline Point2D lerp(const Point2D& a, const Point2D& b, double t) {
-	return Point2D(
+template <typename T>
+inline Point2DT<T> lerp(const Point2DT<T>& a, const Point2DT<T>& b, typename Point2DT<T>::Scalar t) {
+	return Point2DT<T>(
 		lerp(a.x, b.x, t),
 		lerp(a.y, b.y, t)
 	);
 }
 
-double angle(const Point2D& a, const Point2D& o, const Point2D& b);
+template <typename T>
+T angle(const Point2DT<T>& a, const Point2DT<T>& o, const Point2DT<T>& b);
 
 /*
  * Vector in a 2D Space
  */
-struct Vec2D
+template <typename T>
+struct Vec2DT
 {
-	double x;
-	double y;
+	typedef T Scalar;
 
-	Vec2D() : x(0.0), y(0.0) { }
+	T x;
+	T y;
 
-	Vec2D(double _x, double _y) : x(_x), y(_y) { }
+	Vec2DT() : x(0.0), y(0.0) { }
 
-	Vec2D(const Point2D& p) : x(p.x), y(p.y) { }
+	Vec2DT(T _x, T _y) : x(_x), y(_y) { }
 
-	Vec2D(const Point2D& a, const Point2D& b) : x(b.x - a.x), y(b.y - a.y) { }
+	Vec2DT(const Point2DT<T>& p) : x(p.x), y(p.y) { }
+
+	Vec2DT(const Point2DT<T>& a, const Point2DT<T>& b) : x(b.x - a.x), y(b.y - a.y) { }
+
+	// Conversion from another precision
+	template <typename U>
+	explicit Vec2DT(const Vec2DT<U>& v) : x(T(v.x)), y(T(v.y)) { }
 
 	// Unary Point operators
-	Vec2D& operator+=(const Vec2D& v) { x += v.x; y += v.y; return *this; }
-	Vec2D& operator-=(const Vec2D& v) { x -= v.x; y -= v.y; return *this; }
+	Vec2DT& operator+=(const Vec2DT& v) { x += v.x; y += v.y; return *this; }
+	Vec2DT& operator-=(const Vec2DT& v) { x -= v.x; y -= v.y; return *this; }
 
 	// Scalar operators
-	Vec2D& operator*=(double s) { x *= s; y *= s; return *this; }
-	Vec2D& operator/=(double s) { x /= s; y /= s; return *this; }
+	Vec2DT& operator*=(T s) { x *= s; y *= s; return *this; }
+	Vec2DT& operator/=(T s) { x /= s; y /= s; return *this; }
 
 	// Unary minus operator
-	Vec2D operator-() const { return Vec2D(-x, -y); }
+	Vec2DT operator-() const { return Vec2DT(-x, -y); }
 };
 
 // Comparison operators
-inline bool operator==(const Vec2D& lhs, const Vec2D& rhs) {
+template <typename T>
+inline bool operator==(const Vec2DT<T>& lhs, const Vec2DT<T>& rhs) {
 	return ((fabs(lhs.x - rhs.x) < EPS) && (fabs(lhs.y - rhs.y) < EPS));
 }
 
-inline bool operator!=(const Vec2D& lhs, const Vec2D& rhs) {
+template <typename T>
+inline bool operator!=(const Vec2DT<T>& lhs, const Vec2DT<T>& rhs) {
 	return !(lhs == rhs);
 }
 
 // Binary Vector operators
-inline Vec2D operator+(const Vec2D& a, const Vec2D& b) {
-	return Vec2D(a) += b;
+template <typename T>
+inline Vec2DT<T> operator+(const Vec2DT<T>& a, const Vec2DT<T>& b) {
+	return Vec2DT<T>(a) += b;
 }
 
-inline Vec2D operator-(const Vec2D& a, const Vec2D& b) {
-	return Vec2D(a) -= b;
+template <typename T>
+inline Vec2DT<T> operator-(const Vec2DT<T>& a, const Vec2DT<T>& b) {
+	return Vec2DT<T>(a) -= b;
 }
 
 // Binary scalar operators
-inline Vec2D operator*(const Vec2D& a, double s) {
-	return Vec2D(a) *= s;
+template <typename T>
+inline Vec2DT<T> operator*(const Vec2DT<T>& a, typename Vec2DT<T>::Scalar s) {
+	return Vec2DT<T>(a) *= s;
 }
 
-inline Vec2D operator*(double s, const Vec2D& a) {
-	return Vec2D(a) *= s;
+template <typename T>
+inline Vec2DT<T> operator*(typename Vec2DT<T>::Scalar s, const Vec2DT<T>& a) {
+	return Vec2DT<T>(a) *= s;
 }
 
-inline Vec2D operator/(const Vec2D& a, double s) {
-	return Vec2D(a) /= s;
+template <typename T>
+inline Vec2DT<T> operator/(const Vec2DT<T>& a, typename Vec2DT<T>::Scalar s) {
+	return Vec2DT<T>(a) /= s;
 }
 
 // Utility functions
-inline double norm_sq(const Vec2D& a) {
+template <typename T>
+inline T norm_sq(const Vec2DT<T>& a) {
 	return a.x * a.x + a.y * a.y;
 }
 
-inline double norm(const Vec2D& a) {
-	return sqrt(norm_sq(a));
+template <typename T>
+inline T norm(const Vec2DT<T>& a) {
+	return std::sqrt(norm_sq(a));
 }
 
-inline double hypot(const Vec2D& a) {
-	return hypot(a.x, a.y);
+template <typename T>
+inline T hypot(const Vec2DT<T>& a) {
+	return std::hypot(a.x, a.y);
 }
 
-inline double dot(const Vec2D& a, const Vec2D& b) {
+template <typename T>
+inline T dot(const Vec2DT<T>& a, const Vec2DT<T>& b) {
 	return a.x * b.x + a.y * b.y;
 }
 
-inline double cross(const Vec2D& a, const Vec2D& b) {
+template <typename T>
+inline T cross(const Vec2DT<T>& a, const Vec2DT<T>& b) {
 	return a.x * b.y - a.y * b.x;
 }
 
-inline Vec2D normalized(const Vec2D& a) {
-	const double n = norm(a);
-	return Vec2D(a.x / n, a.y / n);
+template <typename T>
+inline Vec2DT<T> normalized(const Vec2DT<T>& a) {
+	const T n = norm(a);
+	return Vec2DT<T>(a.x / n, a.y / n);
 }
 
-inline Vec2D rotateCCW90(const Vec2D& v) {
-	return Vec2D(-v.y, v.x);
+template <typename T>
+inline Vec2DT<T> rotateCCW90(const Vec2DT<T>& v) {
+	return Vec2DT<T>(-v.y, v.x);
 }
 
-inline Vec2D rotateCW90(const Vec2D& v) {
-	return Vec2D(v.y, -v.x);
+template <typename T>
+inline Vec2DT<T> rotateCW90(const Vec2DT<T>& v) {
+	return Vec2DT<T>(v.y, -v.x);
 }
 
-inline double angle(const Vec2D& oa, const Vec2D& ob) {
-	return acos(dot(oa, ob) / sqrt(norm_sq(oa) * norm_sq(ob)));
+template <typename T>
+inline T angle(const Vec2DT<T>& oa, const Vec2DT<T>& ob) {
+	return std::acos(dot(oa, ob) / std::sqrt(norm_sq(oa) * norm_sq(ob)));
 }
 
 /*
  * Segment in a 2D Space
  */
-struct Segment2D
+template <typename T>
+struct Segment2DT
 {
-	Point2D a;
-	Point2D b;
+	typedef T Scalar;
+
+	Point2DT<T> a;
+	Point2DT<T> b;
+
+	Segment2DT() = default;
 
-	Segment2D() = default;
+	Segment2DT(const Point2DT<T>& _a, const Point2DT<T>& _b) : a(_a), b(_b) { }
 
-	Segment2D(const Point2D& _a, const Point2D& _b) : a(_a), b(_b) { }
+	// Conversion from another precision
+	template <typename U>
+	explicit Segment2DT(const Segment2DT<U>& s) : a(s.a), b(s.b) { }
 };
 
 // Utility functions
-inline double length_sq(const Segment2D& s) {
+template <typename T>
+inline T length_sq(const Segment2DT<T>& s) {
 	return dist_sq(s.a, s.b);
 }
 
-inline double length(const Segment2D& s) {
+template <typename T>
+inline T length(const Segment2DT<T>& s) {
 	return dist(s.a, s.b);
 }
 
-inline Point2D lerp(const Segment2D& s, double t) {
+template <typename T>
+inline Point2DT<T> lerp(const Segment2DT<T>& s, typename Segment2DT<T>::Scalar t) {
 	return lerp(s.a, s.b, t);
 }
 
-inline Point2D MidPoint(const Segment2D& s) {
-	return Point2D(
-		(s.a.x + s.b.x) / 2.0,
-		(s.a.y + s.b.y) / 2.0
+template <typename T>
+inline Point2DT<T> MidPoint(const Segment2DT<T>& s) {
+	return Point2DT<T>(
+		(s.a.x + s.b.x) / T(2.0),
+		(s.a.y + s.b.y) / T(2.0)
 	);
 }
 
-template <size_t N>
-std::array<Point2D, N> SubdivideInPoints(const Segment2D& s)
+template <size_t N, typename T>
+std::array<Point2DT<T>, N> SubdivideInPoints(const Segment2DT<T>& s)
 {
-	std::array<Point2D, N> points;
+	std::array<Point2DT<T>, N> points;
 
 	for (int n = 0; n < points.size(); n++)
 	{
-		const double t = double(n + 1) / (N + 1);
+		const T t = T(n + 1) / (N + 1);
 		points[n] = lerp(s.a, s.b, t);
 	}
 
 	return points;
 }
 
-double pointLineProjection(const Point2D& p, const Point2D& a, const Point2D& b);
-double pointLineProjection(const Point2D& p, const Segment2D& s);
+template <typename T>
+T pointLineProjection(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b);
+template <typename T>
+T pointLineProjection(const Point2DT<T>& p, const Segment2DT<T>& s);
 
-double pointLineSegmentProjection(const Point2D& p, const Point2D& a, const Point2D& b);
-double pointLineSegmentProjection(const Point2D& p, const Segment2D& s);
+template <typename T>
+T pointLineSegmentProjection(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b);
+template <typename T>
+T pointLineSegmentProjection(const Point2DT<T>& p, const Segment2DT<T>& s);
 
-double distToLine(const Point2D& p, const Point2D& a, const Point2D& b, Point2D& c);
+template <typename T>
+T distToLine(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b, Point2DT<T>& c);
 
-double distToLineSegment(const Point2D& p, const Point2D& a, const Point2D& b, Point2D& c);
-double distToLineSegment(const Point2D& p, const Segment2D& s, Point2D& c);
+template <typename T>
+T distToLineSegment(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b, Point2DT<T>& c);
+template <typename T>
+T distToLineSegment(const Point2DT<T>& p, const Segment2DT<T>& s, Point2DT<T>& c);
 
-#endif // MATH2D_H
\ No newline at end of file
+#endif // MATH2D_H
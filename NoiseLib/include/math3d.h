@@ -7,95 +7,119 @@
 #include "utils.h"
 #include "math2d.h"
 
-struct Point3D;
-struct Vec3D;
-struct Segment3D;
+template <typename T> struct Point3DT;
+template <typename T> struct Vec3DT;
+template <typename T> struct Segment3DT;
+
+// Geometry in double precision, used by default
+typedef Point3DT<double> Point3D;
+typedef Vec3DT<double> Vec3D;
+typedef Segment3DT<double> Segment3D;
 
 /*
  * Point in a 3D Space
  */
-struct Point3D
+template <typename T>
+struct Point3DT
 {
-	double x;
-	double y;
-	double z;
+	typedef T Scalar;
+
+	T x;
+	T y;
+	T z;
 
-	Point3D() : x(0.0), y(0.0), z(0.0) { }
+	Point3DT() : x(0.0), y(0.0), z(0.0) { }
 
-	Point3D(double _x, double _y, double _z) : x(_x), y(_y), z(_z) { }
+	Point3DT(T _x, T _y, T _z) : x(_x), y(_y), z(_z) { }
 
-	explicit Point3D(const Point2D& point, double _z) : x(point.x), y(point.y), z(_z) { }
+	explicit Point3DT(const Point2DT<T>& point, T _z) : x(point.x), y(point.y), z(_z) { }
+
+	// Conversion from another precision
+	template <typename U>
+	explicit Point3DT(const Point3DT<U>& p) : x(T(p.x)), y(T(p.y)), z(T(p.z)) { }
 
 	// Unary Point operators
-	Point3D& operator+=(const Point3D& p) { x += p.x; y += p.y; z += p.z; return *this; }
-	Point3D& operator-=(const Point3D& p) { x -= p.x; y -= p.y; z -= p.z; return *this; }
+	Point3DT& operator+=(const Point3DT& p) { x += p.x; y += p.y; z += p.z; return *this; }
+	Point3DT& operator-=(const Point3DT& p) { x -= p.x; y -= p.y; z -= p.z; return *this; }
 
 	// Unary Vector operators
-	Point3D& operator+=(const Vec3D& v);
-	Point3D& operator-=(const Vec3D& v);
+	Point3DT& operator+=(const Vec3DT<T>& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	Point3DT& operator-=(const Vec3DT<T>& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
 
 	// Scalar operators
-	Point3D& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
-	Point3D& operator/=(double s) { x /= s; y /= s; z /= s; return *this; }
+	Point3DT& operator*=(T s) { x *= s; y *= s; z *= s; return *this; }
+	Point3DT& operator/=(T s) { x /= s; y /= s; z /= s; return *this; }
 
 	// Unary minus operator
-	Point3D operator-() const { return { -x, -y, -z }; }
+	Point3DT operator-() const { return { -x, -y, -z }; }
 };
 
 // Comparison operators
-inline bool operator==(const Point3D& lhs, const Point3D& rhs) {
+template <typename T>
+inline bool operator==(const Point3DT<T>& lhs, const Point3DT<T>& rhs) {
 	return ((fabs(lhs.x - rhs.x) < EPS)
 		 && (fabs(lhs.y - rhs.y) < EPS)
 		 && (fabs(lhs.z - rhs.z) < EPS));
 }
 
-inline bool operator!=(const Point3D& lhs, const Point3D& rhs) {
+template <typename T>
+inline bool operator!=(const Point3DT<T>& lhs, const Point3DT<T>& rhs) {
 	return !(lhs == rhs);
 }
 
 // Binary Point operators
-inline Point3D operator+(const Point3D& a, const Point3D& b) {
-	return Point3D(a) += b;
+template <typename T>
+inline Point3DT<T> operator+(const Point3DT<T>& a, const Point3DT<T>& b) {
+	return Point3DT<T>(a) += b;
 }
 
-inline Point3D operator-(const Point3D& a, const Point3D& b) {
-	return Point3D(a) -= b;
+template <typename T>
+inline Point3DT<T> operator-(const Point3DT<T>& a, const Point3DT<T>& b) {
+	return Point3DT<T>(a) -= b;
 }
 
 // Binary Vector operators
-inline Point3D operator+(const Point3D& a, const Vec3D& v) {
-	return Point3D(a) += v;
+template <typename T>
+inline Point3DT<T> operator+(const Point3DT<T>& a, const Vec3DT<T>& v) {
+	return Point3DT<T>(a) += v;
 }
 
-inline Point3D operator-(const Point3D& a, const Vec3D& v) {
-	return Point3D(a) -= v;
+template <typename T>
+inline Point3DT<T> operator-(const Point3DT<T>& a, const Vec3DT<T>& v) {
+	return Point3DT<T>(a) -= v;
 }
 
 // Binary scalar operators
-inline Point3D operator*(const Point3D& a, double s) {
-	return Point3D(a) *= s;
+template <typename T>
+inline Point3DT<T> operator*(const Point3DT<T>& a, typename Point3DT<T>::Scalar s) {
+	return Point3DT<T>(a) *= s;
 }
 
-inline Point3D operator*(double s, const Point3D& a) {
-	return Point3D(a) *= s;
+template <typename T>
+inline Point3DT<T> operator*(typename Point3DT<T>::Scalar s, const Point3DT<T>& a) {
+	return Point3DT<T>(a) *= s;
 }
 
-inline Point3D operator/(const Point3D& a, double s) {
-	return Point3D(a) /= s;
+template <typename T>
+inline Point3DT<T> operator/(const Point3DT<T>& a, typename Point3DT<T>::Scalar s) {
+	return Point3DT<T>(a) /= s;
 }
 
 // Utility functions
-inline double dist_sq(const Point3D& lhs, const Point3D& rhs) {
+template <typename T>
+inline T dist_sq(const Point3DT<T>& lhs, const Point3DT<T>& rhs) {
 	return (lhs.x - rhs.x) * (lhs.x - rhs.x)
 		 + (lhs.y - rhs.y) * (lhs.y - rhs.y)
 		 + (lhs.z - rhs.z) * (lhs.z - rhs.z);
 }
 
-inline double dist(const Point3D& lhs, const Point3D& rhs) {
-	return sqrt(dist_sq(lhs, rhs));
+template <typename T>
+inline T dist(const Point3DT<T>& lhs, const Point3DT<T>& rhs) {
+	return std::sqrt(dist_sq(lhs, rhs));
 }
 
-inline Point3D lerp(const Point3D& a, const Point3D& b, double t) {
+template <typename T>
+inline Point3DT<T> lerp(const Point3DT<T>& a, const Point3DT<T>& b, typename Point3DT<T>::Scalar t) {
 	return {
 		lerp(a.x, b.x, t),
 		lerp(a.y, b.y, t),
@@ -103,88 +127,107 @@ inline Point3D lerp(const Point3D& a, const Point3D& b, double t) {
 	};
 }
 
-inline Point2D ProjectionZ(const Point3D& p) {
+template <typename T>
+inline Point2DT<T> ProjectionZ(const Point3DT<T>& p) {
 	return { p.x, p.y };
 }
 
 /*
  * Vector in a 3D Space
  */
-struct Vec3D
+template <typename T>
+struct Vec3DT
 {
-	double x;
-	double y;
-	double z;
+	typedef T Scalar;
+
+	T x;
+	T y;
+	T z;
 
-	Vec3D() : x(0.0), y(0.0), z(0.0) { }
+	Vec3DT() : x(0.0), y(0.0), z(0.0) { }
 
-	Vec3D(double _x, double _y, double _z) : x(_x), y(_y), z(_z) { }
+	Vec3DT(T _x, T _y, T _z) : x(_x), y(_y), z(_z) { }
 
-	explicit Vec3D(const Point3D& p) : x(p.x), y(p.y), z(p.z) { }
+	explicit Vec3DT(const Point3DT<T>& p) : x(p.x), y(p.y), z(p.z) { }
 
-	explicit Vec3D(const Point3D& a, const Point3D& b) : x(b.x - a.x), y(b.y - a.y), z(b.z - a.z) { }
+	explicit Vec3DT(const Point3DT<T>& a, const Point3DT<T>& b) : x(b.x - a.x), y(b.y - a.y), z(b.z - a.z) { }
 
-	explicit Vec3D(const Vec2D& vec, double _z) : x(vec.x), y(vec.y), z(_z) { }
+	explicit Vec3DT(const Vec2DT<T>& vec, T _z) : x(vec.x), y(vec.y), z(_z) { }
+
+	// Conversion from another precision
+	template <typename U>
+	explicit Vec3DT(const Vec3DT<U>& v) : x(T(v.x)), y(T(v.y)), z(T(v.z)) { }
 
 	// Unary Point operators
-	Vec3D& operator+=(const Vec3D& v) { x += v.x; y += v.y; z += v.z; return *this; }
-	Vec3D& operator-=(const Vec3D& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	Vec3DT& operator+=(const Vec3DT& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	Vec3DT& operator-=(const Vec3DT& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
 
 	// Scalar operators
-	Vec3D& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
-	Vec3D& operator/=(double s) { x /= s; y /= s; z /= s; return *this; }
+	Vec3DT& operator*=(T s) { x *= s; y *= s; z *= s; return *this; }
+	Vec3DT& operator/=(T s) { x /= s; y /= s; z /= s; return *this; }
 
 	// Unary minus operator
-	Vec3D operator-() const { return Vec3D(-x, -y, -z); }
+	Vec3DT operator-() const { return Vec3DT(-x, -y, -z); }
 };
 
 // Comparison operators
-inline bool operator==(const Vec3D& lhs, const Vec3D& rhs) {
+template <typename T>
+inline bool operator==(const Vec3DT<T>& lhs, const Vec3DT<T>& rhs) {
 	return ((fabs(lhs.x - rhs.x) < EPS)
 		 && (fabs(lhs.y - rhs.y) < EPS)
 		 && (fabs(lhs.z - rhs.z) < EPS));
 }
 
-inline bool operator!=(const Vec3D& lhs, const Vec3D& rhs) {
+template <typename T>
+inline bool operator!=(const Vec3DT<T>& lhs, const Vec3DT<T>& rhs) {
 	return !(lhs == rhs);
 }
 
 // Binary Vector operators
-inline Vec3D operator+(const Vec3D& a, const Vec3D& b) {
-	return Vec3D(a) += b;
+template <typename T>
+inline Vec3DT<T> operator+(const Vec3DT<T>& a, const Vec3DT<T>& b) {
+	return Vec3DT<T>(a) += b;
 }
 
-inline Vec3D operator-(const Vec3D& a, const Vec3D& b) {
-	return Vec3D(a) -= b;
+template <typename T>
+inline Vec3DT<T> operator-(const Vec3DT<T>& a, const Vec3DT<T>& b) {
+	return Vec3DT<T>(a) -= b;
 }
 
 // Binary scalar operators
-inline Vec3D operator*(const Vec3D& a, double s) {
-	return Vec3D(a) *= s;
+template <typename T>
+inline Vec3DT<T> operator*(const Vec3DT<T>& a, typename Vec3DT<T>::Scalar s) {
+	return Vec3DT<T>(a) *= s;
 }
 
-inline Vec3D operator*(double s, const Vec3D& a) {
-	return Vec3D(a) *= s;
+template <typename T>
+inline Vec3DT<T> operator*(typename Vec3DT<T>::Scalar s, const Vec3DT<T>& a) {
+	return Vec3DT<T>(a) *= s;
 }
 
-inline Vec3D operator/(const Vec3D& a, double s) {
-	return Vec3D(a) /= s;
+template <typename T>
+inline Vec3DT<T> operator/(const Vec3DT<T>& a, typename Vec3DT<T>::Scalar s) {
+	return Vec3DT<T>(a) /= s;
 }
 
 // Utility functions
-inline double norm_sq(const Vec3D& a) {
+template <typename T>
+inline T norm_sq(const Vec3DT<T>& a) {
 	return a.x * a.x + a.y * a.y + a.z * a.z;
 }
 
-inline double norm(const Vec3D& a) {
-	return sqrt(norm_sq(a));
+template <typename T>
+inline T norm(const Vec3DT<T>& a) {
+	return std::sqrt(norm_sq(a));
 }
 
-inline double dot(const Vec3D& a, const Vec3D& b) {
+template <typename T>
+inline T dot(const Vec3DT<T>& a, const Vec3DT<T>& b) {
 	return a.x * b.x + a.y * b.y + a.z * b.z;
 }
 
-inline Vec3D cross(const Vec3D& a, const Vec3D& b) {
+template <typename T>
+inline Vec3DT<T> cross(const Vec3DT<T>& a, const Vec3DT<T>& b) {
 	return {
 		a.y * b.z - a.z * b.y,
 		a.z * b.x - a.x * b.z,
@@ -192,40 +235,44 @@ inline Vec3D cross(const Vec3D& a, const Vec3D& b) {
 	};
 }
 
-inline Vec3D normalized(const Vec3D& a) {
-	const double n = norm(a);
+template <typename T>
+inline Vec3DT<T> normalized(const Vec3DT<T>& a) {
+	const T n = norm(a);
 	return { a.x / n, a.y / n, a.z / n };
 }
 
-inline Vec2D ProjectionZ(const Vec3D& v) {
+template <typename T>
+inline Vec2DT<T> ProjectionZ(const Vec3DT<T>& v) {
 	return { v.x, v.y };
 }
 
-inline double angle(const Vec3D& oa, const Vec3D& ob) {
-	return acos(dot(oa, ob) / sqrt(norm_sq(oa) * norm_sq(ob)));
+template <typename T>
+inline T angle(const Vec3DT<T>& oa, const Vec3DT<T>& ob) {
+	return std::acos(dot(oa, ob) / std::sqrt(norm_sq(oa) * norm_sq(ob)));
 }
 
-inline Vec3D rotate_axis(const Vec3D& v, const Vec3D& axis, double angle)
+template <typename T>
+inline Vec3DT<T> rotate_axis(const Vec3DT<T>& v, const Vec3DT<T>& axis, typename Vec3DT<T>::Scalar angle)
 {
-	assert(abs(norm_sq(axis) - 1.0) < 1e-6);
+	assert(std::abs(norm_sq(axis) - 1.0) < 1e-6);
 
-	const double sinAngle = sin(angle);
-	const double cosAngle = cos(angle);
-	const double oneMinusCosAngle = 1.0 - cosAngle;
+	const T sinAngle = std::sin(angle);
+	const T cosAngle = std::cos(angle);
+	const T oneMinusCosAngle = T(1.0) - cosAngle;
 
-	const Vec3D rotMatrixRow0 = {
+	const Vec3DT<T> rotMatrixRow0 = {
 		axis.x * axis.x + cosAngle * (1 - axis.x * axis.x),
 		axis.x * axis.y * oneMinusCosAngle - sinAngle * axis.z,
 		axis.x * axis.z * oneMinusCosAngle + sinAngle * axis.y
 	};
 
-	const Vec3D rotMatrixRow1 = {
+	const Vec3DT<T> rotMatrixRow1 = {
 		axis.x * axis.y * oneMinusCosAngle + sinAngle * axis.z,
 		axis.y * axis.y + cosAngle * (1 - axis.y * axis.y),
 		axis.y * axis.z * oneMinusCosAngle - sinAngle * axis.x
 	};
 
-	const Vec3D rotMatrixRow2 = {
+	const Vec3DT<T> rotMatrixRow2 = {
 		axis.x * axis.z * oneMinusCosAngle - sinAngle * axis.y,
 		axis.y * axis.z * oneMinusCosAngle + sinAngle * axis.x,
 		axis.z * axis.z + cosAngle * (1 - axis.z * axis.z)
@@ -238,73 +285,136 @@ inline Vec3D rotate_axis(const Vec3D& v, const Vec3D& axis, double angle)
 	};
 }
 
-struct Segment3D
+template <typename T>
+struct Segment3DT
 {
-	Point3D a;
-	Point3D b;
+	typedef T Scalar;
+
+	Point3DT<T> a;
+	Point3DT<T> b;
+
+	Segment3DT() = default;
 
-	Segment3D() = default;
+	explicit Segment3DT(const Point3DT<T>& _a, const Point3DT<T>& _b) : a(_a), b(_b) { }
 
-	explicit Segment3D(const Point3D& _a, const Point3D& _b) : a(_a), b(_b) { }
+	// Conversion from another precision
+	template <typename U>
+	explicit Segment3DT(const Segment3DT<U>& s) : a(s.a), b(s.b) { }
 };
 
 // Utility functions
-inline double length_sq(const Segment3D& s) {
+template <typename T>
+inline T length_sq(const Segment3DT<T>& s) {
 	return dist_sq(s.a, s.b);
 }
 
-inline double length(const Segment3D& s) {
+template <typename T>
+inline T length(const Segment3DT<T>& s) {
 	return dist(s.a, s.b);
 }
 
-inline Point3D lerp(const Segment3D& s, double t) {
+template <typename T>
+inline Point3DT<T> lerp(const Segment3DT<T>& s, typename Segment3DT<T>::Scalar t) {
 	return lerp(s.a, s.b, t);
 }
 
-inline Point3D MidPoint(const Segment3D& s) {
+template <typename T>
+inline Point3DT<T> MidPoint(const Segment3DT<T>& s) {
 	return {
-		(s.a.x + s.b.x) / 2.0,
-		(s.a.y + s.b.y) / 2.0,
-		(s.a.z + s.b.z) / 2.0
+		(s.a.x + s.b.x) / T(2.0),
+		(s.a.y + s.b.y) / T(2.0),
+		(s.a.z + s.b.z) / T(2.0)
 	};
 }
 
-template <size_t N>
-std::array<Point3D, N> SubdivideInPoints(const Segment3D& s)
+/*
+ * Chain of D connected segments, stored as a polyline of D + 1 points
+ */
+template <size_t D, typename T = double>
+struct Segment3DChain
+{
+	static_assert(D > 0, "A chain should have at least one segment.");
+
+	typedef T Scalar;
+
+	std::array<Point3DT<T>, D + 1> points;
+
+	/*
+	 * Iterator over the segments of the chain
+	 */
+	class const_iterator
+	{
+	public:
+		explicit const_iterator(const Point3DT<T>* point) : m_point(point) { }
+
+		Segment3DT<T> operator*() const { return Segment3DT<T>(m_point[0], m_point[1]); }
+
+		const_iterator& operator++() { ++m_point; return *this; }
+
+		bool operator==(const const_iterator& other) const { return m_point == other.m_point; }
+		bool operator!=(const const_iterator& other) const { return m_point != other.m_point; }
+
+	private:
+		const Point3DT<T>* m_point;
+	};
+
+	Segment3DChain() = default;
+
+	explicit Segment3DChain(const Point3DT<T>& start, const std::array<Point3DT<T>, D - 1>& midPoints, const Point3DT<T>& end)
+	{
+		points.front() = start;
+		for (unsigned int d = 0; d < midPoints.size(); d++)
+		{
+			points[d + 1] = midPoints[d];
+		}
+		points.back() = end;
+	}
+
+	// Number of segments
+	static constexpr size_t size() { return D; }
+
+	// k-th segment of the chain
+	Segment3DT<T> operator[](size_t k) const { return Segment3DT<T>(points[k], points[k + 1]); }
+
+	const_iterator begin() const { return const_iterator(points.data()); }
+	const_iterator end() const { return const_iterator(points.data() + D); }
+};
+
+template <size_t N, typename T>
+std::array<Point3DT<T>, N> SubdivideInPoints(const Segment3DT<T>& s)
 {
-	std::array<Point3D, N> points;
+	std::array<Point3DT<T>, N> points;
 
 	for (int n = 0; n < points.size(); n++)
 	{
-		const double t = double(n + 1) / (N + 1);
+		const T t = T(n + 1) / (N + 1);
 		points[n] = lerp(s.a, s.b, t);
 	}
 
 	return points;
 }
 
-template <size_t N>
-std::array<Segment3D, N> SubdivideInSegments(const Segment3D& s)
+template <size_t N, typename T>
+Segment3DChain<N, T> SubdivideInSegments(const Segment3DT<T>& s)
 {
 	static_assert(N > 0, "Segment should be divided in at least one part.");
 
-	std::array<Segment3D, N> segments;
+	Segment3DChain<N, T> segments;
 
-	segments.front().a = s.a;
+	segments.points.front() = s.a;
 	for (int n = 0; n < segments.size() - 1; n++)
 	{
-		const double t = double(n + 1) / N;
-		const Point3D point = lerp(s.a, s.b, t);
-		segments[n].b = point;
-		segments[n + 1].a = point;
+		const T t = T(n + 1) / N;
+		segments.points[n + 1] = lerp(s.a, s.b, t);
 	}
-	segments.back().b = s.b;
+	segments.points.back() = s.b;
 
 	return segments;
 }
 
-inline Segment2D ProjectionZ(const Segment3D& s) {
+template <typename T>
+inline Segment2DT<T> ProjectionZ(const Segment3DT<T>& s) {
 	return { ProjectionZ(s.a), ProjectionZ(s.b) };
 }
 
-#endif // MATH3D_H
\ No newline at end of file
+#endif // MATH3D_H
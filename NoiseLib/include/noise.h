@@ -1,14 +1,21 @@
 #ifndef NOISE_H
 #define NOISE_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <numeric>
 #include <vector>
 #include <random>
 #include <tuple>
+#include <utility>
 #include <limits>
 #include <cmath>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <mutex>
 
 #include "math2d.h"
 #include "math3d.h"
@@ -16,8 +23,102 @@
 #include "utils.h"
 #include "perlin.h"
 #include "controlfunction.h"
+#include "controlfunctioncache.h"
+#include "pointstore.h"
+#include "randomgenerator.h"
+#include "segmentdistance.h"
+#include "displaypolicy.h"
+#include "distancetransform.h"
 
-template <typename I>
+/// <summary>
+/// A rectangle of pixels in a raster covering the whole noise domain
+/// </summary>
+struct TileRect
+{
+	int left;
+	int top;
+	int width;
+	int height;
+
+	TileRect() : left(0), top(0), width(0), height(0) {}
+
+	TileRect(int left, int top, int width, int height) : left(left), top(top), width(width), height(height) {}
+};
+
+/// <summary>
+/// Outputs of a terrain at a point, computed from a single traversal of the hierarchy
+/// </summary>
+struct TerrainChannels
+{
+	// Elevation, as displayed by the function output
+	double height;
+	// Distance to the nearest segment, as displayed by the distance output
+	double distance;
+	// 1 near to a segment, as displayed by the segments output, 0 elsewhere
+	double mask;
+	// Level of the nearest segment, from 1 for the coarsest level, 0 if there is no segment
+	int level;
+	// Identifier of the nearest segment, the same at all the points where it is the nearest
+	uint64_t segmentId;
+
+	TerrainChannels() : height(0.0), distance(0.0), mask(0.0), level(0), segmentId(0) {}
+};
+
+/// <summary>
+/// Lookups of the level cache of a noise since it was constructed
+/// </summary>
+struct LevelCacheStatistics
+{
+	uint64_t hits;
+	uint64_t misses;
+	// Levels replaced in their slot by the level of another cell
+	uint64_t evictions;
+
+	double hitRate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+};
+
+// Maximum number of levels in the hierarchy of a noise, the evaluation is compiled for each number of levels up to this one
+const int MAX_LEVELS = 8;
+
+// Maximum number of cells, summed over the levels, of the river graph and of the level 1 field built over the noise domain
+const int RIVER_GRAPH_MAX_CELLS = 1 << 20;
+
+// Number of mutexes protecting the slots of the level cache of a noise, slot i is protected by mutex i % LEVEL_CACHE_MUTEXES
+const std::size_t LEVEL_CACHE_MUTEXES = 64;
+
+/// <summary>
+/// Constants of the level L of the hierarchy, the coarsest level is 1
+/// </summary>
+template <int L>
+struct LevelDescriptor
+{
+	static_assert(L >= 1 && L <= MAX_LEVELS, "Invalid level");
+
+	// Resolution of the cells of the level
+	static constexpr int resolution = 1 << (L - 1);
+
+	// Number of points in each dimension of the neighborhood of a cell
+	static constexpr size_t points = (L == 1) ? 9 : 5;
+
+	// Number of segments in the chains of the level
+	static constexpr size_t chain = (L <= 4) ? 5 - L : 1;
+
+	// The displacement of the segments is the one of level 1 divided by this factor, 0 if segments are not displaced
+	static constexpr int displacementDivisor = (L <= 3) ? 1 << (2 * (L - 1)) : 0;
+
+	// Minimum slope of rivers connecting the points of the level to the segments of coarser levels
+	static constexpr double riversMinSlope = (L == 1) ? 0.0 : (L == 2) ? 0.09 : (L == 3) ? 0.18 : (L == 4) ? 0.38 : 1.0;
+};
+
+/// <summary>
+/// Noise function using the control function I.
+/// The segments are generated, subdivided and searched with the scalar type T, float
+/// trades some precision for speed. The cells, the topology of the segments and the
+/// control function are always evaluated in double precision.
+/// The outputs that are displayed are given by the policy Display, a StaticDisplay
+/// fixes them at compile time and removes the evaluation of the others.
+/// </summary>
+template <typename I, typename T = double, typename Display = RuntimeDisplay>
 class Noise
 {
 public:
@@ -37,18 +138,30 @@ public:
 		  bool displayPoints = false,
 	      bool displaySegments = false,
 	      bool displayGrid = false,
-		  bool displayDistance = false);
+		  bool displayDistance = false,
+		  RandomGeneratorType randomGeneratorType = RandomGeneratorType::MersenneTwister,
+		  std::shared_ptr<PointStore> pointStore = nullptr,
+		  std::shared_ptr<ControlFunctionCache> controlFunctionCache = nullptr,
+		  std::size_t levelCacheCapacity = 0);
 
 	double evaluateTerrain(double x, double y) const;
+	double evaluateTerrainWithGradient(double x, double y, double& dx, double& dy) const;
+	TerrainChannels evaluateTerrainChannels(double x, double y) const;
 	double evaluateLichtenberg(double x, double y) const;
 
+	void evaluateTerrainTile(const TileRect& rect, int width, int height, std::vector<double>& out) const;
+	void evaluateTerrainChannelsTile(const TileRect& rect, int width, int height, std::vector<TerrainChannels>& out) const;
+	void evaluateDistanceRaster(int width, int height, std::vector<double>& out) const;
+	void drawLichtenbergTile(const TileRect& rect, int width, int height, std::vector<double>& out) const;
+	void evaluateLichtenbergTile(const TileRect& rect, int width, int height, std::vector<double>& out) const;
+	void evaluateLichtenbergLevelsTile(const TileRect& rect, int width, int height, std::vector<double>& out) const;
+
+	LevelCacheStatistics levelCacheStatistics() const;
+
 private:
 	// ----- Types -----
-	template <typename T, size_t N>
-	using Array2D = std::array<std::array<T, N>, N>;
-
-	template <size_t D>
-	using Segment3DChain = std::array<Segment3D, D>;
+	template <typename V, size_t N>
+	using Array2D = std::array<std::array<V, N>, N>;
 
 	template <size_t N>
 	using DoubleArray = Array2D<double, N>;
@@ -56,10 +169,43 @@ private:
 	template <size_t N>
 	using Point2DArray = Array2D<Point2D, N>;
 
+	/// <summary>
+	/// Segment chains in neighboring cells.
+	/// The segments projected on the plane z = 0 are also stored as a structure of arrays
+	/// indexed by (i * N + j) * D + k for the nearest segment search. They are updated by
+	/// project(), which must be called once the segments are final.
+	/// </summary>
 	template <size_t N, size_t D>
-	using Segment3DChainArray = Array2D<Segment3DChain<D>, N>;
+	struct Segment3DChainArray : public Array2D<Segment3DChain<D, T>, N>
+	{
+		std::array<T, N * N * D> ax;
+		std::array<T, N * N * D> ay;
+		std::array<T, N * N * D> bx;
+		std::array<T, N * N * D> by;
+
+		void project()
+		{
+			for (unsigned int i = 0; i < N; i++)
+			{
+				for (unsigned int j = 0; j < N; j++)
+				{
+					const std::array<Point3DT<T>, D + 1>& points = (*this)[i][j].points;
+
+					for (unsigned int k = 0; k < D; k++)
+					{
+						const unsigned int index = (i * N + j) * D + k;
+
+						ax[index] = points[k].x;
+						ay[index] = points[k].y;
+						bx[index] = points[k + 1].x;
+						by[index] = points[k + 1].y;
+					}
+				}
+			}
+		}
+	};
 
-	// Random generator used by the class
+	// Legacy random generator used by the class
 	typedef std::mt19937_64 RandomGenerator;
 
 	enum class ConnectionStrategy
@@ -82,30 +228,249 @@ private:
 		Cell() : x(0), y(0), resolution(0) {}
 
 		Cell(const int x, const int y, const int resolution) : x(x), y(y), resolution(resolution) {}
+
+		bool operator==(const Cell& other) const { return x == other.x && y == other.y && resolution == other.resolution; }
+		bool operator!=(const Cell& other) const { return !(*this == other); }
 	};
 
-	// ----- Points -----
+	/// <summary>
+	/// Points and segments around the cell containing a point at the level L
+	/// </summary>
+	template <int L>
+	struct Level
+	{
+		Cell cell;
+		Point2DArray<LevelDescriptor<L>::points> points;
+		Segment3DChainArray<5, LevelDescriptor<L>::chain> segments;
+	};
+
+	/// <summary>
+	/// Slot of the level cache, holding the level L built in a cell with a strategy
+	/// </summary>
+	template <int L>
+	struct LevelCacheSlot
+	{
+		ConnectionStrategy strategy;
+		std::unique_ptr<Level<L> > level;
+
+		LevelCacheSlot() : strategy(ConnectionStrategy::Rivers) {}
+	};
+
+	template <typename Sequence>
+	struct LevelCacheTuple;
+
+	template <int... K>
+	struct LevelCacheTuple<std::integer_sequence<int, K...> >
+	{
+		typedef std::tuple<std::vector<LevelCacheSlot<K + 1> >...> Type;
+	};
+
+	/// <summary>
+	/// Primitive of a terrain, centered on a point of the highest resolution
+	/// </summary>
+	struct Primitive
+	{
+		Point2D center;
+		// Elevation of the primitive, without noise
+		double elevation;
+		// Amplitude of the noise of the primitive
+		double amplitude;
+	};
+
+	/// <summary>
+	/// Primitives around the highest resolution cell containing a point.
+	/// They only depend on the cell, so that all the points in the cell share them.
+	/// </summary>
+	template <size_t N>
+	struct PrimitiveLattice
+	{
+		Cell cell;
+		Array2D<Primitive, N> primitives;
+	};
+
+	/// <summary>
+	/// Constants of the evaluation, prepared once when the noise is constructed
+	/// </summary>
+	struct EvaluationContext
+	{
+		// Transform from the noise domain to the control function domain, computed like remap
+		Point2D noiseOrigin;
+		Vec2D noiseSize;
+		Point2D controlFunctionOrigin;
+		Vec2D controlFunctionSize;
+
+		// Bounds of the control function
+		double controlFunctionMinimum;
+		double controlFunctionMaximum;
+
+		// Radius of the points and segments displayed at each level
+		std::array<double, MAX_LEVELS> displayRadius;
+
+		// Size of the cells of each level in the control function domain
+		std::array<double, MAX_LEVELS> cellFootprint;
+
+		// Radius of the primitives of the terrain
+		double primitiveRadius;
+		// Maximum amplitude of the noise of the primitives
+		double amplitudeMax;
+		// Distance to the segments from which the noise of the primitives has its maximum amplitude
+		double amplitudeDistance;
+		// Wavelengths of the noise of the primitives
+		double wavelengthX;
+		double wavelengthY;
+	};
+
+	template <typename Sequence>
+	struct LevelTuple;
+
+	template <int... K>
+	struct LevelTuple<std::integer_sequence<int, K...> >
+	{
+		typedef std::tuple<Level<K + 1>...> Type;
+	};
+
+	/// <summary>
+	/// Points and segments of the levels 1 to Depth around the cells containing a point.
+	/// Levels are only rebuilt when the point moves to another cell, so that
+	/// neighboring points share the work done in coarse levels.
+	/// </summary>
+	template <int Depth>
+	struct Hierarchy
+	{
+		// Number of levels currently built
+		int levels;
+
+		typename LevelTuple<std::make_integer_sequence<int, Depth> >::Type level;
+
+		// Primitives of the terrain around the point, built from the last level
+		PrimitiveLattice<LevelDescriptor<Depth>::points> primitives;
+
+		Hierarchy() : levels(0) {}
+
+		template <int L>
+		Level<L>& get() { return std::get<L - 1>(level); }
+
+		template <int L>
+		const Level<L>& get() const { return std::get<L - 1>(level); }
+
+		// Cells and segments of the levels 1 to L, in the order of the nearest segment functions
+		template <int L>
+		auto cellsAndSegments() const { return CellsAndSegments(std::make_integer_sequence<int, L>()); }
+
+		// Cells, segments and points of the levels 1 to L, in the order of the ComputeColor function
+		template <int L>
+		auto cellsSegmentsAndPoints() const { return CellsSegmentsAndPoints(std::make_integer_sequence<int, L>()); }
+
+	private:
+		template <int... K>
+		auto CellsAndSegments(std::integer_sequence<int, K...>) const
+		{
+			return std::tuple_cat(std::tie(get<K + 1>().cell, get<K + 1>().segments)...);
+		}
+
+		template <int... K>
+		auto CellsSegmentsAndPoints(std::integer_sequence<int, K...>) const
+		{
+			return std::tuple_cat(std::tie(get<K + 1>().cell, get<K + 1>().segments, get<K + 1>().points)...);
+		}
+	};
+
+	/// <summary>
+	/// Points and segment chains of the cells of the level L in a rectangle of cells.
+	/// The chain of a cell is the one starting from its point.
+	/// </summary>
+	template <int L>
+	struct LevelGraph
+	{
+		// First cell of the rectangle and number of cells in each dimension
+		int x;
+		int y;
+		int width;
+		int height;
+
+		// Point and chain of each cell, row by row
+		std::vector<Point2D> points;
+		std::vector<Segment3DChain<LevelDescriptor<L>::chain, T> > chains;
+
+		LevelGraph() : x(0), y(0), width(0), height(0) {}
+
+		std::size_t index(int cellX, int cellY) const
+		{
+			assert(cellX >= x && cellX < x + width && cellY >= y && cellY < y + height);
+
+			return std::size_t(cellY - y) * width + (cellX - x);
+		}
+	};
+
+	template <typename Sequence>
+	struct LevelGraphTuple;
+
+	template <int... K>
+	struct LevelGraphTuple<std::integer_sequence<int, K...> >
+	{
+		typedef std::tuple<LevelGraph<K + 1>...> Type;
+	};
+
+	/// <summary>
+	/// Points and segments of all the levels over a region of the noise domain, generated once with the same
+	/// rules as the hierarchies. The levels of a point of the region are read from the cells around it
+	/// instead of being generated again.
+	/// </summary>
+	struct SegmentGraph
+	{
+		// Points whose levels are in the graph
+		Point2D minimum;
+		Point2D maximum;
+
+		typename LevelGraphTuple<std::make_integer_sequence<int, MAX_LEVELS> >::Type level;
 
-	void InitPointCache();
+		template <int L>
+		LevelGraph<L>& get() { return std::get<L - 1>(level); }
+
+		template <int L>
+		const LevelGraph<L>& get() const { return std::get<L - 1>(level); }
+
+		bool contains(double x, double y) const
+		{
+			return x >= minimum.x && x <= maximum.x && y >= minimum.y && y <= maximum.y;
+		}
+	};
+
+	// ----- Points -----
 
 	RandomGenerator InitRandomGenerator(int i, int j) const;
 
-	Point2D GeneratePoint(int x, int y) const;
-	Point2D GeneratePointCached(int x, int y) const;
+	template <size_t N>
+	std::array<double, N> GenerateDisplacementFactors(double displacementFactor, const Cell& cell) const;
 
 	// ----- Utils -----
 
+	EvaluationContext PrepareContext() const;
+
+	Point2D ToControlFunction(const Point2D& point) const;
+
+	double DisplayRadius(const Cell& cell) const;
+
 	Cell GetCell(double x, double y, int resolution) const;
 
 	double EvaluateControlFunction(const Point2D& point) const;
 
+	template <size_t N>
+	std::array<double, N> EvaluateControlFunction(const std::array<Point2D, N>& points, double footprint) const;
+
 	bool InsideDomain(const Point2D& point) const;
 
-	bool InsideDomain(const Segment2D& segment) const;
+	template <size_t N>
+	std::array<bool, N> InsideDomain(const std::array<Point2D, N>& points) const;
+
+	template <typename S>
+	bool InsideDomain(const Segment2DT<S>& segment) const;
 	
-	bool InsideDomain(const Point3D& point) const;
+	template <typename S>
+	bool InsideDomain(const Point3DT<S>& point) const;
 
-	bool InsideDomain(const Segment3D& segment) const;
+	template <typename S>
+	bool InsideDomain(const Segment3DT<S>& segment) const;
 
 	bool DistToDomain(const Point2D& point) const;
 
@@ -114,40 +479,40 @@ private:
 	bool ControlFunctionMaximum() const;
 
 	template <size_t D>
-	Segment3DChain<D> ConnectPointToSegmentAngle(const Point3D& point, double segmentDist, const Segment3D& segment) const;
+	Segment3DChain<D, T> ConnectPointToSegmentAngle(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const;
 
 	template <size_t D>
-	Segment3DChain<D> ConnectPointToSegmentAngleMid(const Point3D& point, double segmentDist, const Segment3D& segment) const;
+	Segment3DChain<D, T> ConnectPointToSegmentAngleMid(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const;
 
 	template <size_t D>
-	Segment3DChain<D> ConnectPointToSegmentNearestPoint(const Point3D& point, double segmentDist, const Segment3D& segment) const;
+	Segment3DChain<D, T> ConnectPointToSegmentNearestPoint(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const;
 
 	template <size_t D>
-	Segment3DChain<D> ConnectPointToSegmentRivers(const Point3D& point, double segmentDist, const Segment3D& segment) const;
+	Segment3DChain<D, T> ConnectPointToSegmentRivers(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const;
 
-	template <size_t D>
-	Segment3DChain<D> ConnectPointToSegment(const ConnectionStrategy& strategy, const Point3D& point, double segmentDist, const Segment3D& segment) const;
+	template <ConnectionStrategy S, size_t D>
+	Segment3DChain<D, T> ConnectPointToSegment(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const;
 
-	template <typename T, size_t N>
-	std::tuple<int, int> GetArrayCell(const Cell& arrCell, const Array2D<T, N>& arr, const Cell& cell) const;
+	template <typename V, size_t N>
+	std::tuple<int, int> GetArrayCell(const Cell& arrCell, const Array2D<V, N>& arr, const Cell& cell) const;
 
 	template <size_t N, size_t D>
-	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const;
+	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const;
 
 	template <size_t N, size_t D, typename ...Tail>
-	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
+	double NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
 
 	template <size_t N, size_t D>
-	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const;
+	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const;
 
 	template <size_t N, size_t D, typename ...Tail>
-	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
+	double NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
 
 	template <size_t N>
-	int SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentEndingInP) const;
+	int SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3DT<T>& point, Segment3DT<T>& lastSegmentEndingInP) const;
 
 	template <size_t N>
-	int SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentStartingInP) const;
+	int SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3DT<T>& point, Segment3DT<T>& lastSegmentStartingInP) const;
 
 	// ----- Generate -----
 
@@ -158,13 +523,10 @@ private:
 	void ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>& points, const Cell& subCell, Point2DArray<N>& subPoints) const;
 
 	template <size_t N>
-	DoubleArray<N> ComputeElevations(const Point2DArray<N>& points) const;
+	DoubleArray<N> ComputeElevations(const Point2DArray<N>& points, double footprint) const;
 	
 	template <size_t N>
-	Segment3DChainArray<N - 2, 1> GenerateSegments(const Point2DArray<N>& points) const;
-
-	template <size_t D>
-	void SegmentChainFromPoints(const Point3D& start, const std::array<Point3D, D - 1>& midPoints, const Point3D& end, Segment3DChain<D>& outSegmentChain) const;
+	Segment3DChainArray<N - 2, 1> GenerateSegments(const Point2DArray<N>& points, double footprint) const;
 
 	template <size_t N, size_t D>
 	void SubdivideSegments(const Cell& cell, const Segment3DChainArray<N, 1>& segments, Segment3DChainArray<N - 2, D>& subdividedSegments) const;
@@ -178,8 +540,81 @@ private:
 	template <size_t N2, size_t N1, size_t D1, typename ...Tail>
 	void CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, Tail&&... tail) const;
 
-	template <size_t N, size_t D, typename ...Tail>
-	Segment3DChainArray<N, D> GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Point2DArray<N>& points, Tail&&... tail) const;
+	template <ConnectionStrategy S, size_t N, size_t D, typename ...Tail>
+	Segment3DChainArray<N, D> GenerateSubSegments(double minSlope, double footprint, const Point2DArray<N>& points, Tail&&... tail) const;
+
+	// ----- Evaluate -----
+
+	template <int Depth = 1, typename F>
+	auto WithLevels(F&& f) const;
+
+	template <ConnectionStrategy S, int L, int Depth>
+	void BuildLevels(double x, double y, Hierarchy<Depth>& hierarchy) const;
+
+	template <int Depth>
+	void BuildTerrainHierarchy(double x, double y, bool primitives, Hierarchy<Depth>& hierarchy) const;
+
+	std::size_t LevelCacheSlotIndex(ConnectionStrategy S, const Cell& cell) const;
+
+	template <ConnectionStrategy S, int L>
+	bool FindCachedLevel(const Cell& cell, Level<L>& level) const;
+
+	template <ConnectionStrategy S, int L>
+	void StoreCachedLevel(const Level<L>& level) const;
+
+	bool GetSegmentGraphBounds(int levels, Point2D& minimum, Point2D& maximum) const;
+
+	const SegmentGraph* GetRiverGraph() const;
+
+	const SegmentGraph* GetLevelOneField() const;
+
+	template <ConnectionStrategy S, int Depth>
+	void BuildLevelsFromField(double x, double y, Hierarchy<Depth>& hierarchy) const;
+
+	template <ConnectionStrategy S, int L, int Depth>
+	void BuildSegmentGraph(SegmentGraph& graph) const;
+
+	template <int L, int Depth, int Last = Depth>
+	void BuildLevelsFromGraph(double x, double y, const SegmentGraph& graph, Hierarchy<Depth>& hierarchy) const;
+
+	template <int L, int Depth>
+	void RasterizeSegments(const SegmentGraph& graph, const TileRect& rect, int width, int height, std::vector<double>& seeds) const;
+
+	template <int Depth>
+	void BuildLichtenbergHierarchy(double x, double y, Hierarchy<Depth>& hierarchy) const;
+
+	template <int L, int Depth>
+	void DrawLevels(const SegmentGraph& graph, const TileRect& rect, int width, int height, std::vector<double>& out) const;
+
+	void DrawStroke(const Point2D& a, const Point2D& b, double halfWidth, double extension, const TileRect& rect, int width, int height, std::vector<double>& out) const;
+
+	void DrawDisk(const Point2D& center, double radius, const TileRect& rect, int width, int height, std::vector<double>& out) const;
+
+	double BoxCoverage(double lower, double upper, double footprint) const;
+
+	template <int Depth>
+	double ComputeTerrainValue(double x, double y, const Hierarchy<Depth>& hierarchy) const;
+
+	template <int Depth>
+	double ComputeTerrainValueWithGradient(double x, double y, const Hierarchy<Depth>& hierarchy, double& dx, double& dy) const;
+
+	template <int Depth>
+	TerrainChannels ComputeTerrainChannels(double x, double y, const Hierarchy<Depth>& hierarchy) const;
+
+	uint64_t SegmentId(int resolution, const Segment3DT<T>& segment) const;
+
+	template <int Depth>
+	double ComputeLichtenbergValue(double x, double y, const Hierarchy<Depth>& hierarchy) const;
+
+	template <int L, int Depth>
+	void ComputeLichtenbergLevels(double x, double y, const Hierarchy<Depth>& hierarchy, double color, double distance, std::size_t stride, double* values) const;
+
+	Point2D TilePixel(int i, int j, int width, int height) const;
+
+	template <int L = 1>
+	void PrefetchControlFunction(const Point2D& topLeft, const Point2D& bottomRight) const;
+
+	std::vector<int> TileTraversalOrder(const TileRect& rect, int width, int height, int levels) const;
 
 	// ----- Compute Color -----
 
@@ -200,6 +635,9 @@ private:
 
 	double ComputeColorGrid(double x, double y, double deltaX, double deltaY, double radius) const;
 
+	template <size_t N, size_t D, typename ...Tail>
+	double ComputeColorSegmentsMask(double x, double y, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const;
+
 	template <size_t N1, size_t D1, size_t N2>
 	double ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points) const;
 
@@ -207,7 +645,13 @@ private:
 	double ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points, Tail&&... tail) const;
 
 	template <size_t N, typename ...Tail>
-	double ComputeColorPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const;
+	void BuildPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, PrimitiveLattice<N>& lattice, Tail&&... tail) const;
+
+	template <size_t N>
+	double ComputeColorPrimitives(double x, double y, const PrimitiveLattice<N>& lattice) const;
+
+	template <size_t N>
+	double ComputeColorPrimitivesWithGradient(double x, double y, const PrimitiveLattice<N>& lattice, double& dx, double& dy) const;
 
 	template <typename ...Tail>
 	double ComputeColorControlFunction(double x, double y, Tail&&... tail) const;
@@ -215,17 +659,26 @@ private:
 	template <typename ...Tail>
 	double ComputeColorDistance(double x, double y, Tail&&... tail) const;
 
+	template <typename ...Tail>
+	double ComputeColorDistanceWithGradient(double x, double y, double& dx, double& dy, Tail&&... tail) const;
+
 	// Seed of the noise
 	const int m_seed;
 
+	// Random generator used to place points and displace segments
+	const RandomGeneratorType m_randomGeneratorType;
+
+	// Points generated in cells, possibly shared with other noises
+	const std::shared_ptr<PointStore> m_pointStore;
+
 	// A control function
 	const std::unique_ptr<ControlFunction<I> > m_controlFunction;
 
-	const bool m_displayFunction;
-	const bool m_displayPoints;
-	const bool m_displaySegments;
-	const bool m_displayGrid;
-	const bool m_displayDistance;
+	// Values of the control function at the points of the cells, no cache if nullptr
+	const std::shared_ptr<ControlFunctionCache> m_controlFunctionCache;
+
+	// Outputs displayed by the noise
+	const Display m_display;
 
 	const Point2D m_noiseTopLeft;
 	const Point2D m_noiseBottomRight;
@@ -250,20 +703,37 @@ private:
 	// Additional parameter to control the variation of slope on terrains
 	const double m_slopePower;
 
-	const int CACHE_X = 128;
-	const int CACHE_Y = 128;
-	std::vector<std::vector<Point2D> > m_pointCache;
+	// Constants of the evaluation, prepared from the parameters above
+	const EvaluationContext m_context;
+
+	// Segments of the terrain over the noise domain, built by the first evaluation of the terrain.
+	// nullptr if the domain has too many cells, then the levels are generated for each point.
+	mutable std::once_flag m_riverGraphBuilt;
+	mutable std::unique_ptr<const SegmentGraph> m_riverGraph;
+
+	// Level 1 over the noise domain, built by the first evaluation without the river graph.
+	// nullptr if the domain has too many cells, then the level 1 is generated for each point.
+	mutable std::once_flag m_levelOneFieldBuilt;
+	mutable std::unique_ptr<const SegmentGraph> m_levelOneField;
+
+	// Levels built in cells, shared by all the threads evaluating the noise. Each cell maps to one slot
+	// per level, and a new level replaces the one stored in its slot. Disabled if the capacity is 0.
+	std::size_t m_levelCacheCapacity;
+	mutable typename LevelCacheTuple<std::make_integer_sequence<int, MAX_LEVELS> >::Type m_levelCache;
+	mutable std::array<std::mutex, LEVEL_CACHE_MUTEXES> m_levelCacheMutexes;
+	mutable std::atomic<uint64_t> m_levelCacheHits;
+	mutable std::atomic<uint64_t> m_levelCacheMisses;
+	mutable std::atomic<uint64_t> m_levelCacheEvictions;
 };
 
-template <typename I>
-Noise<I>::Noise(std::unique_ptr<ControlFunction<I> > controlFunction, const Point2D& noiseTopLeft, const Point2D& noiseBottomRight, const Point2D & controlFunctionTopLeft, const Point2D & controlFunctionBottomRight, int seed, double eps, int resolution, double displacement, int primitivesResolutionSteps, double slopePower, double noiseAmplitudeProportion, bool displayFunction, bool displayPoints, bool displaySegments, bool displayGrid, bool displayDistance) :
+template <typename I, typename T, typename Display>
+Noise<I, T, Display>::Noise(std::unique_ptr<ControlFunction<I> > controlFunction, const Point2D& noiseTopLeft, const Point2D& noiseBottomRight, const Point2D & controlFunctionTopLeft, const Point2D & controlFunctionBottomRight, int seed, double eps, int resolution, double displacement, int primitivesResolutionSteps, double slopePower, double noiseAmplitudeProportion, bool displayFunction, bool displayPoints, bool displaySegments, bool displayGrid, bool displayDistance, RandomGeneratorType randomGeneratorType, std::shared_ptr<PointStore> pointStore, std::shared_ptr<ControlFunctionCache> controlFunctionCache, std::size_t levelCacheCapacity) :
 	m_seed(seed),
+	m_randomGeneratorType(randomGeneratorType),
+	m_pointStore(pointStore != nullptr ? std::move(pointStore) : PointStore::shared(seed, eps, randomGeneratorType)),
 	m_controlFunction(std::move(controlFunction)),
-	m_displayFunction(displayFunction),
-	m_displayPoints(displayPoints),
-	m_displaySegments(displaySegments),
-	m_displayGrid(displayGrid),
-	m_displayDistance(displayDistance),
+	m_controlFunctionCache(std::move(controlFunctionCache)),
+	m_display(displayFunction, displayPoints, displaySegments, displayGrid, displayDistance),
 	m_noiseTopLeft(noiseTopLeft),
 	m_noiseBottomRight(noiseBottomRight),
 	m_controlFunctionTopLeft(controlFunctionTopLeft),
@@ -273,78 +743,149 @@ Noise<I>::Noise(std::unique_ptr<ControlFunction<I> > controlFunction, const Poin
 	m_displacement(displacement),
     m_primitivesResolutionSteps(primitivesResolutionSteps),
 	m_noiseAmplitudeProportion(noiseAmplitudeProportion),
-	m_slopePower(slopePower)
-{
-	InitPointCache();
-}
-
-template <typename I>
-void Noise<I>::InitPointCache()
+	m_slopePower(slopePower),
+	m_context(PrepareContext()),
+	m_levelCacheCapacity(0),
+	m_levelCacheHits(0),
+	m_levelCacheMisses(0),
+	m_levelCacheEvictions(0)
 {
-	m_pointCache.resize(CACHE_X);
-
-	for (int x = -CACHE_X / 2; x < CACHE_X / 2; x++)
+	assert(m_pointStore->seed() == m_seed);
+	assert(m_pointStore->eps() == m_eps);
+	assert(m_pointStore->randomGeneratorType() == m_randomGeneratorType);
+	// Slots are found by masking a hash, the capacity is rounded up to a power of two
+	if (levelCacheCapacity > 0)
 	{
-		m_pointCache[x + CACHE_X / 2].resize(CACHE_Y);
-
-		for (int y = -CACHE_Y / 2; y < CACHE_Y / 2; y++)
+		m_levelCacheCapacity = 1;
+		while (m_levelCacheCapacity < levelCacheCapacity)
 		{
-			m_pointCache[x + CACHE_X / 2][y + CACHE_Y / 2] = GeneratePoint(x, y);
+			m_levelCacheCapacity <<= 1;
 		}
 	}
+
+	std::apply([this](auto&... slots) {
+		(slots.resize(m_levelCacheCapacity), ...);
+	}, m_levelCache);
 }
 
-template <typename I>
-typename Noise<I>::RandomGenerator Noise<I>::InitRandomGenerator(int i, int j) const
+template <typename I, typename T, typename Display>
+typename Noise<I, T, Display>::RandomGenerator Noise<I, T, Display>::InitRandomGenerator(int i, int j) const
 {
-	// TODO: implement a better permutation method
-	const int seed = (541 * i + 79 * j + m_seed) % std::numeric_limits<int>::max();
-	// Fixed seed for internal consistency
-	return RandomGenerator(seed);
+	return InitLegacyRandomGenerator(m_seed, i, j);
 }
 
 /// <summary>
-/// Generate a point in a cell.
+/// Generate the displacement factors of a segment chain starting in a cell.
 /// This function is reproducible.
 /// </summary>
-/// <param name="x">x coordinate of the cell</param>
-/// <param name="y">y coordinate of the cell</param>
-/// <returns>A Point2D in this cell</returns>
-template <typename I>
-Point2D Noise<I>::GeneratePoint(int x, int y) const
+/// <param name="displacementFactor">Maximum absolute value of the factors</param>
+/// <param name="cell">Cell containing the first point of the segment chain</param>
+/// <returns>N factors uniformly distributed in [-displacementFactor, displacementFactor[</returns>
+template <typename I, typename T, typename Display>
+template <size_t N>
+std::array<double, N> Noise<I, T, Display>::GenerateDisplacementFactors(double displacementFactor, const Cell& cell) const
 {
-	RandomGenerator generator = InitRandomGenerator(x, y);
+	std::array<double, N> factors;
 
-	std::uniform_real_distribution<double> distribution(m_eps, 1.0 - m_eps);
-	const double px = distribution(generator);
-	const double py = distribution(generator);
+	if (m_randomGeneratorType == RandomGeneratorType::CounterBased)
+	{
+		CounterRandomGenerator generator(m_seed, cell.resolution, cell.x, cell.y, DISPLACEMENT_STREAM);
+		for (unsigned int k = 0; k < factors.size(); k++)
+		{
+			factors[k] = generator.uniform(-displacementFactor, displacementFactor);
+		}
+	}
+	else
+	{
+		RandomGenerator generator = InitRandomGenerator(cell.x, cell.y);
+		std::uniform_real_distribution<double> distribution(-displacementFactor, displacementFactor);
+		for (unsigned int k = 0; k < factors.size(); k++)
+		{
+			factors[k] = distribution(generator);
+		}
+	}
 
-	return { double(x) + px, double(y) + py };
+	return factors;
 }
 
 /// <summary>
-/// Generate a point in a cell.
-/// This function is reproducible.
-/// Use the point cache if possible.
+/// Prepare the constants of the evaluation from the parameters of the noise
 /// </summary>
-/// <param name="x">x coordinate of the cell</param>
-/// <param name="y">y coordinate of the cell</param>
-/// <returns>A Point2D in this cell</returns>
-template <typename I>
-Point2D Noise<I>::GeneratePointCached(int x, int y) const
+template <typename I, typename T, typename Display>
+typename Noise<I, T, Display>::EvaluationContext Noise<I, T, Display>::PrepareContext() const
 {
-	if (x >= -CACHE_X / 2 && x < CACHE_X / 2 && y >= -CACHE_Y / 2 && y < CACHE_Y / 2)
+	EvaluationContext context;
+
+	context.noiseOrigin = m_noiseTopLeft;
+	context.noiseSize = Vec2D(m_noiseTopLeft, m_noiseBottomRight);
+	context.controlFunctionOrigin = m_controlFunctionTopLeft;
+	context.controlFunctionSize = Vec2D(m_controlFunctionTopLeft, m_controlFunctionBottomRight);
+
+	context.controlFunctionMinimum = ControlFunctionMinimum();
+	context.controlFunctionMaximum = ControlFunctionMaximum();
+
+	for (int level = 0; level < MAX_LEVELS; level++)
 	{
-		return m_pointCache[x + CACHE_X / 2][y + CACHE_Y / 2];
+		context.displayRadius[level] = 1.0 / (26 * std::exp(0.085 * (1 << level)));
 	}
-	else
+
+	// Cells of the level 1 have a size of 1 in the noise domain
+	const double cellFootprint = std::max(std::abs(context.controlFunctionSize.x / context.noiseSize.x), std::abs(context.controlFunctionSize.y / context.noiseSize.y));
+	for (int level = 0; level < MAX_LEVELS; level++)
 	{
-		return GeneratePoint(x, y);
+		context.cellFootprint[level] = cellFootprint / (1 << level);
 	}
+
+	// Primitives are centered on the points of the last level, refined m_primitivesResolutionSteps times
+	const int higherResolution = 1 << std::max(m_resolution - 1, 0);
+	const int highestResolution = higherResolution << std::max(m_primitivesResolutionSteps, 0);
+	const double periodPerCell = 4.0;
+	const double terrainSizeX = m_noiseBottomRight.x - m_noiseTopLeft.x;
+	const double terrainSizeY = m_noiseBottomRight.y - m_noiseTopLeft.y;
+	const double higherResCellSize = std::max(terrainSizeX, terrainSizeY) / higherResolution;
+	const double highestResCellSizeX = terrainSizeX / highestResolution;
+	const double highestResCellSizeY = terrainSizeY / highestResolution;
+
+	context.primitiveRadius = 2.0 / highestResolution;
+	context.amplitudeMax = m_noiseAmplitudeProportion * (context.controlFunctionMaximum - context.controlFunctionMinimum) / higherResolution;
+	context.amplitudeDistance = higherResCellSize / 4.0;
+	context.wavelengthX = highestResCellSizeX / periodPerCell;
+	context.wavelengthY = highestResCellSizeY / periodPerCell;
+
+	return context;
+}
+
+/// <summary>
+/// Coordinates of a point of the noise domain in the control function domain
+/// </summary>
+template <typename I, typename T, typename Display>
+Point2D Noise<I, T, Display>::ToControlFunction(const Point2D& point) const
+{
+	const double x = m_context.controlFunctionOrigin.x + m_context.controlFunctionSize.x * (point.x - m_context.noiseOrigin.x) / m_context.noiseSize.x;
+	const double y = m_context.controlFunctionOrigin.y + m_context.controlFunctionSize.y * (point.y - m_context.noiseOrigin.y) / m_context.noiseSize.y;
+
+	return { x, y };
+}
+
+/// <summary>
+/// Radius of the points and segments displayed in a cell
+/// </summary>
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::DisplayRadius(const Cell& cell) const
+{
+	int level = 0;
+	while ((1 << level) < cell.resolution)
+	{
+		level++;
+	}
+
+	assert(level < MAX_LEVELS && (1 << level) == cell.resolution);
+
+	return m_context.displayRadius[level];
 }
 
-template <typename I>
-typename Noise<I>::Cell Noise<I>::GetCell(double x, double y, int resolution) const
+template <typename I, typename T, typename Display>
+typename Noise<I, T, Display>::Cell Noise<I, T, Display>::GetCell(double x, double y, int resolution) const
 {
 	// Return the coordinates of the cell in which (x, y)
 	// For example, for resolution 1:
@@ -391,78 +932,188 @@ typename Noise<I>::Cell Noise<I>::GetCell(double x, double y, int resolution) co
 /// </summary>
 /// <param name="point">Coordinates of the point</param>
 /// <returns>The value of the function at the point</returns>
-template <typename I>
-double Noise<I>::EvaluateControlFunction(const Point2D& point) const
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::EvaluateControlFunction(const Point2D& point) const
 {
-	const double x = remap(point.x, m_noiseTopLeft.x, m_noiseBottomRight.x, m_controlFunctionTopLeft.x, m_controlFunctionBottomRight.x);
-	const double y = remap(point.y, m_noiseTopLeft.y, m_noiseBottomRight.y, m_controlFunctionTopLeft.y, m_controlFunctionBottomRight.y);
+	const Point2D p = ToControlFunction(point);
 
 	double value = 0.0;
 
 	if (m_controlFunction)
 	{
-		value = m_controlFunction->evaluate(x, y);
+		value = m_controlFunction->evaluate(p.x, p.y);
 	}
 
 	return value;
 }
 
 /// <summary>
-/// Check if one point (x, y) is in the domain of the control function
+/// Evaluate the control function at N points in one batch.
+/// Only the points missing from the cache are evaluated, and their values are cached.
 /// </summary>
-/// <param name="point">Coordinates of the point</param>
-/// <returns>True if the point is in the domain of the function</returns>
-template <typename I>
-bool Noise<I>::InsideDomain(const Point2D& point) const
+/// <param name="points">Coordinates of the points</param>
+/// <param name="footprint">Size of the area around each point in the control function domain</param>
+/// <returns>The values of the function at the points</returns>
+template <typename I, typename T, typename Display>
+template <size_t N>
+std::array<double, N> Noise<I, T, Display>::EvaluateControlFunction(const std::array<Point2D, N>& points, double footprint) const
 {
-	const double x = remap(point.x, m_noiseTopLeft.x, m_noiseBottomRight.x, m_controlFunctionTopLeft.x, m_controlFunctionBottomRight.x);
-	const double y = remap(point.y, m_noiseTopLeft.y, m_noiseBottomRight.y, m_controlFunctionTopLeft.y, m_controlFunctionBottomRight.y);
+	std::array<double, N> values{};
 
-	bool value = false;
+	// Indices of the points to evaluate
+	std::array<int, N> indices;
+	int count = 0;
+	for (int k = 0; k < int(N); k++)
+	{
+		if (m_controlFunctionCache == nullptr || !m_controlFunctionCache->findElevation(points[k], footprint, values[k]))
+		{
+			indices[count++] = k;
+		}
+	}
 
-	if (m_controlFunction)
+	std::array<double, N> x{};
+	std::array<double, N> y{};
+	for (int k = 0; k < count; k++)
 	{
-		value = m_controlFunction->insideDomain(x, y);
+		const Point2D p = ToControlFunction(points[indices[k]]);
+		x[k] = p.x;
+		y[k] = p.y;
 	}
 
-	return value;
-}
+	std::array<double, N> evaluated{};
 
-template <typename I>
-bool Noise<I>::InsideDomain(const Segment2D& segment) const
-{
-	return (InsideDomain(segment.a) && InsideDomain(segment.b));
-}
+	if (m_controlFunction && count > 0)
+	{
+		m_controlFunction->evaluateBatch(x.data(), y.data(), evaluated.data(), count, footprint);
+	}
 
-template <typename I>
-bool Noise<I>::InsideDomain(const Point3D& point) const {
-	return InsideDomain(ProjectionZ(point));
-}
+	for (int k = 0; k < count; k++)
+	{
+		values[indices[k]] = evaluated[k];
 
-template <typename I>
-bool Noise<I>::InsideDomain(const Segment3D& segment) const
-{
-	return (InsideDomain(segment.a) && InsideDomain(segment.b));
+		if (m_controlFunctionCache != nullptr)
+		{
+			m_controlFunctionCache->storeElevation(points[indices[k]], footprint, evaluated[k]);
+		}
+	}
+
+	return values;
 }
 
-template <typename I>
-bool Noise<I>::DistToDomain(const Point2D& point) const
+/// <summary>
+/// Check if one point (x, y) is in the domain of the control function
+/// </summary>
+/// <param name="point">Coordinates of the point</param>
+/// <returns>True if the point is in the domain of the function</returns>
+template <typename I, typename T, typename Display>
+bool Noise<I, T, Display>::InsideDomain(const Point2D& point) const
 {
-	const double x = remap(point.x, m_noiseTopLeft.x, m_noiseBottomRight.x, m_controlFunctionTopLeft.x, m_controlFunctionBottomRight.x);
-	const double y = remap(point.y, m_noiseTopLeft.y, m_noiseBottomRight.y, m_controlFunctionTopLeft.y, m_controlFunctionBottomRight.y);
+	const Point2D p = ToControlFunction(point);
 
-	double value = 0.0;
+	bool value = false;
 
 	if (m_controlFunction)
 	{
-		value = m_controlFunction->distToDomain(x, y);
+		value = m_controlFunction->insideDomain(p.x, p.y);
 	}
 
 	return value;
 }
 
-template <typename I>
-bool Noise<I>::ControlFunctionMinimum() const
+/// <summary>
+/// Check if N points are in the domain of the control function in one batch.
+/// Only the points missing from the cache are checked, and their membership is cached.
+/// </summary>
+/// <param name="points">Coordinates of the points</param>
+/// <returns>True for the points in the domain of the function</returns>
+template <typename I, typename T, typename Display>
+template <size_t N>
+std::array<bool, N> Noise<I, T, Display>::InsideDomain(const std::array<Point2D, N>& points) const
+{
+	std::array<bool, N> inside{};
+
+	// Indices of the points to check
+	std::array<int, N> indices;
+	int count = 0;
+	for (int k = 0; k < int(N); k++)
+	{
+		bool cached = false;
+		if (m_controlFunctionCache == nullptr || !m_controlFunctionCache->findInsideDomain(points[k], cached))
+		{
+			indices[count++] = k;
+		}
+		else
+		{
+			inside[k] = cached;
+		}
+	}
+
+	std::array<double, N> x{};
+	std::array<double, N> y{};
+	for (int k = 0; k < count; k++)
+	{
+		const Point2D p = ToControlFunction(points[indices[k]]);
+		x[k] = p.x;
+		y[k] = p.y;
+	}
+
+	std::array<bool, N> checked{};
+
+	if (m_controlFunction && count > 0)
+	{
+		m_controlFunction->insideDomainBatch(x.data(), y.data(), checked.data(), count);
+	}
+
+	for (int k = 0; k < count; k++)
+	{
+		inside[indices[k]] = checked[k];
+
+		if (m_controlFunctionCache != nullptr)
+		{
+			m_controlFunctionCache->storeInsideDomain(points[indices[k]], checked[k]);
+		}
+	}
+
+	return inside;
+}
+
+template <typename I, typename T, typename Display>
+template <typename S>
+bool Noise<I, T, Display>::InsideDomain(const Segment2DT<S>& segment) const
+{
+	return (InsideDomain(Point2D(segment.a)) && InsideDomain(Point2D(segment.b)));
+}
+
+template <typename I, typename T, typename Display>
+template <typename S>
+bool Noise<I, T, Display>::InsideDomain(const Point3DT<S>& point) const {
+	return InsideDomain(Point2D(ProjectionZ(point)));
+}
+
+template <typename I, typename T, typename Display>
+template <typename S>
+bool Noise<I, T, Display>::InsideDomain(const Segment3DT<S>& segment) const
+{
+	return (InsideDomain(segment.a) && InsideDomain(segment.b));
+}
+
+template <typename I, typename T, typename Display>
+bool Noise<I, T, Display>::DistToDomain(const Point2D& point) const
+{
+	const Point2D p = ToControlFunction(point);
+
+	double value = 0.0;
+
+	if (m_controlFunction)
+	{
+		value = m_controlFunction->distToDomain(p.x, p.y);
+	}
+
+	return value;
+}
+
+template <typename I, typename T, typename Display>
+bool Noise<I, T, Display>::ControlFunctionMinimum() const
 {
 	double value = 0.0;
 
@@ -474,8 +1125,8 @@ bool Noise<I>::ControlFunctionMinimum() const
 	return value;
 }
 
-template <typename I>
-bool Noise<I>::ControlFunctionMaximum() const
+template <typename I, typename T, typename Display>
+bool Noise<I, T, Display>::ControlFunctionMaximum() const
 {
 	double value = 0.0;
 
@@ -496,15 +1147,13 @@ bool Noise<I>::ControlFunctionMaximum() const
 /// <param name="segmentDist">Distance from the point to the segment</param>
 /// <param name="segment">Segment with which connect the point</param>
 /// <returns>A chain of segments connecting the point with the segment</returns>
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t D>
-typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAngle(const Point3D & point, double segmentDist, const Segment3D& segment) const
+Segment3DChain<D, T> Noise<I, T, Display>::ConnectPointToSegmentAngle(const Point3DT<T> & point, T segmentDist, const Segment3DT<T>& segment) const
 {
-	Segment3DChain<D> generatedSegment;
-
 	// Find an intersection on the segment with respect to constraints
 	// u = 0 is point A of the segment ; u = 1 is point B of the segment
-	double u = pointLineSegmentProjection(ProjectionZ(point), ProjectionZ(segment));
+	T u = pointLineSegmentProjection(ProjectionZ(point), ProjectionZ(segment));
 
 	// If, on the segment, the nearest point is between A and B, we shift it so that the angle constraint is respected
 	if (u > 0.0 && u < 1.0)
@@ -512,7 +1161,7 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 		// Find the intersection so that the angle between the two segments is 45
 		// v designates the ratio of the segment on which the intersection is located
 		// v = 0 is point A of the segment ; v = 1 is point B of the segment
-		const double v = u + segmentDist / length(ProjectionZ(segment));
+		const T v = u + segmentDist / length(ProjectionZ(segment));
 
 		if (v > 1.0)
 		{
@@ -526,16 +1175,16 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 		}
 	}
 
-	const Point3D straightSegmentEnd(lerp(segment, u));
-	const Segment3D straightSegment(point, straightSegmentEnd);
+	const Point3DT<T> straightSegmentEnd(lerp(segment, u));
+	const Segment3DT<T> straightSegment(point, straightSegmentEnd);
 
 	// Subdivide the straightSegment into D smaller segments
-	std::array<Point3D, D - 1> generatedSegmentPoints;
+	std::array<Point3DT<T>, D - 1> generatedSegmentPoints;
 	if (length_sq(straightSegment) > 0.0 && length_sq(segment))
 	{
 		// If the segment exists, we can smooth it
-		const Point3D splineStart = 2.0 * straightSegment.a - straightSegment.b;
-		const Point3D splineEnd = 2.0 * segment.b - segment.a;
+		const Point3DT<T> splineStart = 2.0 * straightSegment.a - straightSegment.b;
+		const Point3DT<T> splineEnd = 2.0 * segment.b - segment.a;
 		generatedSegmentPoints = SubdivideCatmullRomSpline<D - 1>(splineStart, straightSegment.a, straightSegment.b, splineEnd);
 	}
 	else
@@ -544,9 +1193,7 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 		generatedSegmentPoints = SubdivideInPoints<D - 1>(straightSegment);
 	}
 
-	SegmentChainFromPoints(straightSegment.a, generatedSegmentPoints, straightSegment.b, generatedSegment);
-	
-	return generatedSegment;
+	return Segment3DChain<D, T>(straightSegment.a, generatedSegmentPoints, straightSegment.b);
 }
 
 /// <summary>
@@ -558,36 +1205,34 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 /// <param name="segmentDist">Distance from the point to the segment</param>
 /// <param name="segment">Segment with which connect the point</param>
 /// <returns>A chain of segments connecting the point with the segment</returns>
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t D>
-typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAngleMid(const Point3D& point, double segmentDist, const Segment3D& segment) const
+Segment3DChain<D, T> Noise<I, T, Display>::ConnectPointToSegmentAngleMid(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const
 {
-	Segment3DChain<D> generatedSegment;
-
 	// Find an intersection on the segment with respect to constraints
 	// u = 0 is point A of the segment ; u = 1 is point B of the segment
-	const double u = pointLineProjection(ProjectionZ(point), ProjectionZ(segment));
+	const T u = pointLineProjection(ProjectionZ(point), ProjectionZ(segment));
 
-	const double tanAngle = 1.0; // tan(45 deg) = 1.0
+	const T tanAngle = 1.0; // tan(45 deg) = 1.0
 	// Find the intersection so that the angle between the two segments is 45
 	// v designates the ratio of the segment on which the intersection is located
 	// v = 0 is point A of the segment ; v = 1 is point B of the segment
 	// TODO: segmentDist could actually not be the distance to the line which means the angle is not 45 degrees
 	// TODO: make sure that segmentDist is the distance to the line (AB) using u or by recomputing it in this function
-	double v = u + (segmentDist / tanAngle) / length(ProjectionZ(segment));
+	T v = u + (segmentDist / tanAngle) / length(ProjectionZ(segment));
 	// The intersection must lie on the segment
-	v = std::clamp(v, 0.0, 1.0);
+	v = std::clamp(v, T(0.0), T(1.0));
 
-	const Point3D straightSegmentEnd(lerp(segment, v));
-	const Segment3D straightSegment(point, straightSegmentEnd);
+	const Point3DT<T> straightSegmentEnd(lerp(segment, v));
+	const Segment3DT<T> straightSegment(point, straightSegmentEnd);
 
 	// Subdivide the straightSegment into D smaller segments
-	std::array<Point3D, D - 1> generatedSegmentPoints;
+	std::array<Point3DT<T>, D - 1> generatedSegmentPoints;
 	if (length_sq(straightSegment) > 0.0 && length_sq(segment))
 	{
 		// If the segment exists, we can smooth it
-		const Point3D splineStart = 2.0 * straightSegment.a - straightSegment.b;
-		const Point3D splineEnd = 2.0 * segment.b - segment.a;
+		const Point3DT<T> splineStart = 2.0 * straightSegment.a - straightSegment.b;
+		const Point3DT<T> splineEnd = 2.0 * segment.b - segment.a;
 		generatedSegmentPoints = SubdivideCatmullRomSpline<D - 1>(splineStart, straightSegment.a, straightSegment.b, splineEnd);
 	}
 	else
@@ -596,9 +1241,7 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 		generatedSegmentPoints = SubdivideInPoints<D - 1>(straightSegment);
 	}
 
-	SegmentChainFromPoints(straightSegment.a, generatedSegmentPoints, straightSegment.b, generatedSegment);
-
-	return generatedSegment;
+	return Segment3DChain<D, T>(straightSegment.a, generatedSegmentPoints, straightSegment.b);
 }
 
 /// <summary>
@@ -611,39 +1254,37 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentAng
 /// <param name="segmentDist">Distance from the point to the segment</param>
 /// <param name="segment">Segment with which connect the point</param>
 /// <returns>A chain of segments connecting the point with the segment</returns>
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t D>
-typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentNearestPoint(const Point3D& point, double segmentDist, const Segment3D& segment) const
+Segment3DChain<D, T> Noise<I, T, Display>::ConnectPointToSegmentNearestPoint(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const
 {
 	// Find an intersection on the segment with respect to constraints
 	// u = 0 is point A of the segment ; u = 1 is point B of the segment
-	const double u = pointLineSegmentProjection(ProjectionZ(point), ProjectionZ(segment));
+	const T u = pointLineSegmentProjection(ProjectionZ(point), ProjectionZ(segment));
 
-	const Point3D segmentEnd(lerp(segment, u));
-	const Segment3D straightSegment(point, segmentEnd);
+	const Point3DT<T> segmentEnd(lerp(segment, u));
+	const Segment3DT<T> straightSegment(point, segmentEnd);
 
 	// Subdivide the straightSegment into D smaller segments
 	return SubdivideInSegments<D>(straightSegment);
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t D>
-typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentRivers(const Point3D& point, double segmentDist, const Segment3D& segment) const
+Segment3DChain<D, T> Noise<I, T, Display>::ConnectPointToSegmentRivers(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const
 {
-	Segment3DChain<D> generatedSegment;
-
 	// The connection point is the nearest point among A, B and middle of the segment
-	Point3D connectionPoint = MidPoint(segment);
-	double distConnectionPoint = dist(connectionPoint, point);
+	Point3DT<T> connectionPoint = MidPoint(segment);
+	T distConnectionPoint = dist(connectionPoint, point);
 
-	const double distanceA = dist(segment.a, point);
+	const T distanceA = dist(segment.a, point);
 	if (distanceA < distConnectionPoint)
 	{
 		connectionPoint = segment.a;
 		distConnectionPoint = distanceA;
 	}
 
-	const double distanceB = dist(segment.b, point);
+	const T distanceB = dist(segment.b, point);
 	if (distanceB < distConnectionPoint)
 	{
 		connectionPoint = segment.b;
@@ -651,31 +1292,33 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentRiv
 	}
 
 	// Segment before subdivision
-	const Segment3D straightSegment(point, connectionPoint);
+	const Segment3DT<T> straightSegment(point, connectionPoint);
 
 	// Subdivide the straightSegment into D smaller segments
-	std::array<Point3D, D - 1> generatedSegmentPoints;
-	if (length_sq(straightSegment) > 0.0)
+	std::array<Point3DT<T>, D - 1> generatedSegmentPoints;
+	// A single segment has no intermediate point to smooth, and a segment reduced to a point gives no direction
+	if (D > 1 && length_sq(straightSegment) > 0.0 && length_sq(segment) > 0.0)
 	{
 		// Compute the connection angle
-		const double mainSegmentSlope = std::abs(segment.b.z - segment.a.z) / length(ProjectionZ(segment));
-		const double tributarySlope = std::abs(straightSegment.b.z - straightSegment.a.z) / length(ProjectionZ(straightSegment));		
-		double connectionAngle = 0.0;
+		const T mainSegmentSlope = std::abs(segment.b.z - segment.a.z) / length(ProjectionZ(segment));
+		const T tributarySlope = std::abs(straightSegment.b.z - straightSegment.a.z) / length(ProjectionZ(straightSegment));		
+		T connectionAngle = 0.0;
 		if (tributarySlope >= 0.0 && mainSegmentSlope <= tributarySlope)
 		{
-			connectionAngle = acos(mainSegmentSlope / tributarySlope);
+			connectionAngle = std::acos(mainSegmentSlope / tributarySlope);
 		}
 
 		// The three points (segment.a, point, segment.b) constitute a plane
 		// The normal of this plane is the cross product between IP and AB
-		const Vec3D vecSegment(segment.a, segment.b);
-		const Vec3D vecStraightSegment(straightSegment.b, straightSegment.a);
-		const Vec3D normal = normalized(cross(vecStraightSegment, vecSegment));
-		const Vec3D result = rotate_axis(normalized(vecSegment), normal, connectionAngle);
+		const Vec3DT<T> vecSegment(segment.a, segment.b);
+		const Vec3DT<T> vecStraightSegment(straightSegment.b, straightSegment.a);
+		// If the point is aligned with the segment, there is no plane and the direction of the segment is kept
+		const Vec3DT<T> normal = cross(vecStraightSegment, vecSegment);
+		const Vec3DT<T> result = (norm_sq(normal) > 0.0) ? rotate_axis(normalized(vecSegment), normalized(normal), connectionAngle) : normalized(vecSegment);
 
 		// If the segment exists, we can smooth it
-		const Point3D splineStart = 2.0 * straightSegment.a - straightSegment.b;
-		const Point3D splineEnd = connectionPoint + (result * 0.1 * norm(vecStraightSegment));
+		const Point3DT<T> splineStart = 2.0 * straightSegment.a - straightSegment.b;
+		const Point3DT<T> splineEnd = connectionPoint + (result * 0.1 * norm(vecStraightSegment));
 		generatedSegmentPoints = SubdivideCatmullRomSpline<D - 1>(splineStart, straightSegment.a, straightSegment.b, splineEnd);
 	}
 	else
@@ -684,405 +1327,1323 @@ typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegmentRiv
 		generatedSegmentPoints = SubdivideInPoints<D - 1>(straightSegment);
 	}
 
-	SegmentChainFromPoints(straightSegment.a, generatedSegmentPoints, straightSegment.b, generatedSegment);
+	return Segment3DChain<D, T>(straightSegment.a, generatedSegmentPoints, straightSegment.b);
+}
 
-	return generatedSegment;
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, size_t D>
+Segment3DChain<D, T> Noise<I, T, Display>::ConnectPointToSegment(const Point3DT<T>& point, T segmentDist, const Segment3DT<T>& segment) const
+{
+	// The strategy is known at compile time, only the chosen connection is kept
+	if constexpr (S == ConnectionStrategy::Angle)
+	{
+		return ConnectPointToSegmentAngle<D>(point, segmentDist, segment);
+	}
+	else if constexpr (S == ConnectionStrategy::AngleMid)
+	{
+		return ConnectPointToSegmentAngleMid<D>(point, segmentDist, segment);
+	}
+	else if constexpr (S == ConnectionStrategy::Rivers)
+	{
+		return ConnectPointToSegmentRivers<D>(point, segmentDist, segment);
+	}
+	else
+	{
+		return ConnectPointToSegmentNearestPoint<D>(point, segmentDist, segment);
+	}
 }
 
-template <typename I>
-template <size_t D>
-typename Noise<I>::template Segment3DChain<D> Noise<I>::ConnectPointToSegment(const ConnectionStrategy& strategy, const Point3D& point, double segmentDist, const Segment3D& segment) const
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::ComputeColorBase(double dist, double radius) const
+{
+	if (dist < radius)
+	{
+		return 1.0;
+	}
+
+	return 0.0;
+}
+
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::ComputeColorPoint(double x, double y, const Point2D& point, double radius) const
+{
+	const double d = dist(Point2D(x, y), point);
+	return ComputeColorBase(d, radius);
+}
+
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::ComputeColorSegment(double x, double y, const Segment2D& segment, double radius) const
+{
+	Point2D c;
+	const double d = distToLineSegment(Point2D(x, y), segment, c);
+	return ComputeColorBase(d, radius);
+}
+
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::ComputeColorGrid(double x, double y, double deltaX, double deltaY, double radius) const
+{
+	double value = 0.0;
+
+	// When near to the grid
+	if (std::abs(x - floor(x) - deltaX) < radius || std::abs(y - floor(y) - deltaY) < radius)
+	{
+		value = 1.0;
+	}
+
+	return value;
+}
+
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::evaluateTerrain(double x, double y) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	return WithLevels([this, x, y](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		BuildTerrainHierarchy(x, y, m_display.function(), hierarchy);
+
+		return ComputeTerrainValue(x, y, hierarchy);
+	});
+}
+
+/// <summary>
+/// Evaluate the terrain and its gradient in a single traversal of the hierarchy.
+/// The elevation is exactly the one of evaluateTerrain. The gradient is analytic: the
+/// primitives have a constant elevation, so it comes from the blending weights and the
+/// Perlin noise. Outputs that are piecewise constant (points, segments, grid) have a
+/// zero gradient, and the gradient is undefined where the output is not differentiable.
+/// </summary>
+/// <param name="dx">Partial derivative of the elevation along x</param>
+/// <param name="dy">Partial derivative of the elevation along y</param>
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::evaluateTerrainWithGradient(double x, double y, double& dx, double& dy) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	return WithLevels([this, x, y, &dx, &dy](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		BuildTerrainHierarchy(x, y, m_display.function(), hierarchy);
+
+		return ComputeTerrainValueWithGradient(x, y, hierarchy, dx, dy);
+	});
+}
+
+/// <summary>
+/// Evaluate all the outputs of the terrain at once, whatever the outputs displayed by the noise.
+/// Each channel is exactly the value evaluateTerrain returns when only its output is displayed.
+/// </summary>
+template <typename I, typename T, typename Display>
+TerrainChannels Noise<I, T, Display>::evaluateTerrainChannels(double x, double y) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	return WithLevels([this, x, y](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		BuildTerrainHierarchy(x, y, true, hierarchy);
+
+		return ComputeTerrainChannels(x, y, hierarchy);
+	});
+}
+
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::evaluateLichtenberg(double x, double y) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	return WithLevels([this, x, y](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		BuildLichtenbergHierarchy(x, y, hierarchy);
+
+		return ComputeLichtenbergValue(x, y, hierarchy);
+	});
+}
+
+/// <summary>
+/// Evaluate the terrain on a tile of a raster covering the noise domain.
+/// Pixels are evaluated exactly like evaluateTerrain, but the levels are
+/// only built once per cell and shared by all the pixels of the cell.
+/// </summary>
+/// <param name="rect">Pixels of the raster to evaluate</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::evaluateTerrainTile(const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	out.resize(std::size_t(rect.width) * rect.height);
+
+	PrefetchControlFunction(TilePixel(rect.top, rect.left, width, height), TilePixel(rect.top + rect.height, rect.left + rect.width, width, height));
+
+	WithLevels([&](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		// Pixels sharing primitives are also contiguous
+		const int levels = m_resolution + (m_display.function() ? m_primitivesResolutionSteps : 0);
+		for (const int index : TileTraversalOrder(rect, width, height, levels))
+		{
+			const Point2D pixel = TilePixel(rect.top + index / rect.width, rect.left + index % rect.width, width, height);
+
+			BuildTerrainHierarchy(pixel.x, pixel.y, m_display.function(), hierarchy);
+			out[index] = ComputeTerrainValue(pixel.x, pixel.y, hierarchy);
+		}
+	});
+}
+
+/// <summary>
+/// Evaluate all the outputs of the terrain on a tile of a raster covering the noise domain.
+/// Pixels are evaluated exactly like evaluateTerrainChannels, with the levels shared like evaluateTerrainTile.
+/// </summary>
+/// <param name="rect">Pixels of the raster to evaluate</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Outputs of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::evaluateTerrainChannelsTile(const TileRect& rect, int width, int height, std::vector<TerrainChannels>& out) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	out.resize(std::size_t(rect.width) * rect.height);
+
+	PrefetchControlFunction(TilePixel(rect.top, rect.left, width, height), TilePixel(rect.top + rect.height, rect.left + rect.width, width, height));
+
+	WithLevels([&](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		for (const int index : TileTraversalOrder(rect, width, height, m_resolution + m_primitivesResolutionSteps))
+		{
+			const Point2D pixel = TilePixel(rect.top + index / rect.width, rect.left + index % rect.width, width, height);
+
+			BuildTerrainHierarchy(pixel.x, pixel.y, true, hierarchy);
+			out[index] = ComputeTerrainChannels(pixel.x, pixel.y, hierarchy);
+		}
+	});
+}
+
+/// <summary>
+/// Draw the Lichtenberg figure on a tile of a raster covering the noise domain.
+/// Instead of evaluating the figure at each pixel, the points and segments of all the levels around the tile
+/// are gathered once and drawn with the radii of ComputeColor, each pixel taking the area it covers, as if the
+/// figure was infinitely supersampled and box filtered. Segments are drawn as rectangles extended by their
+/// radius at both ends. The distance is not drawn.
+/// </summary>
+/// <param name="rect">Pixels of the raster to draw</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::drawLichtenbergTile(const TileRect& rect, int width, int height, std::vector<double>& out) const
 {
-	Segment3DChain<D> connectionSegments;
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+	assert(!m_display.distance());
+
+	out.assign(std::size_t(rect.width) * rect.height, 0.0);
+
+	// Region of the tile, enlarged by the largest radius so that all the points and segments reaching the tile are gathered
+	const Point2D first = TilePixel(rect.top, rect.left, width, height);
+	const Point2D last = TilePixel(rect.top + rect.height, rect.left + rect.width, width, height);
+	const double margin = m_context.displayRadius[0];
+
+	SegmentGraph graph;
+	graph.minimum = Point2D(std::min(first.x, last.x) - margin, std::min(first.y, last.y) - margin);
+	graph.maximum = Point2D(std::max(first.x, last.x) + margin, std::max(first.y, last.y) + margin);
 
-	switch (strategy)
+	WithLevels([&](auto depth) {
+		BuildSegmentGraph<ConnectionStrategy::AngleMid, 1, decltype(depth)::value>(graph);
+		DrawLevels<1, decltype(depth)::value>(graph, rect, width, height, out);
+		return 0;
+	});
+}
+
+/// <summary>
+/// Evaluate the distance to the segments of the terrain on a raster covering the noise domain.
+/// When the noise has a river graph, the segments are rasterized in a seed image, the pixels within
+/// half a pixel diagonal of a segment, and the distances are the exact Euclidean distance transform of the
+/// seeds. The seed image extends the raster by a cell of the first level on each side, so the distances are within
+/// half a pixel diagonal of the distance to the nearest segment when its nearest point is in the extended raster.
+/// The distance output of evaluateTerrain only searches the segments of the neighboring cells, so it may be larger.
+/// Otherwise, the distances are evaluated for each pixel exactly like the distance output.
+/// </summary>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Distances at the pixels, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::evaluateDistanceRaster(int width, int height, std::vector<double>& out) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+	assert(width > 0 && height > 0);
+
+	const SegmentGraph* graph = GetRiverGraph();
+	if (graph == nullptr)
 	{
-	case ConnectionStrategy::Angle:
-		connectionSegments = ConnectPointToSegmentAngle<D>(point ,segmentDist, segment);
-		break;
+		const TileRect rect(0, 0, width, height);
+		out.resize(std::size_t(width) * height);
 
-	case ConnectionStrategy::AngleMid:
-		connectionSegments = ConnectPointToSegmentAngleMid<D>(point, segmentDist, segment);
-		break;
+		WithLevels([&](auto depth) {
+			Hierarchy<decltype(depth)::value> hierarchy;
+			for (const int index : TileTraversalOrder(rect, width, height, m_resolution))
+			{
+				const Point2D pixel = TilePixel(index / width, index % width, width, height);
 
-	case ConnectionStrategy::Rivers:
-		connectionSegments = ConnectPointToSegmentRivers<D>(point, segmentDist, segment);
-		break;
+				BuildTerrainHierarchy(pixel.x, pixel.y, false, hierarchy);
+				out[index] = std::apply([&](const auto&... tail) {
+					return ComputeColorDistance(pixel.x, pixel.y, tail...);
+				}, hierarchy.template cellsAndSegments<decltype(depth)::value>());
+			}
+		});
 
-	default:
-	case ConnectionStrategy::NearestPoint:
-		connectionSegments = ConnectPointToSegmentNearestPoint<D>(point, segmentDist, segment);
-		break;
+		return;
 	}
 
-	return connectionSegments;
+	const double spacingX = std::abs(m_noiseBottomRight.x - m_noiseTopLeft.x) / width;
+	const double spacingY = std::abs(m_noiseBottomRight.y - m_noiseTopLeft.y) / height;
+
+	// Pixels in a cell of the first level, without extending the raster more than its size
+	const int marginX = int(std::min(std::ceil(1.0 / spacingX), double(width)));
+	const int marginY = int(std::min(std::ceil(1.0 / spacingY), double(height)));
+	const TileRect seedRect(-marginX, -marginY, width + 2 * marginX, height + 2 * marginY);
+
+	std::vector<double> seeds(std::size_t(seedRect.width) * seedRect.height, std::numeric_limits<double>::infinity());
+
+	WithLevels([&](auto depth) {
+		RasterizeSegments<1, decltype(depth)::value>(*graph, seedRect, width, height, seeds);
+		return 0;
+	});
+
+	squaredDistanceTransform(seeds, seedRect.width, seedRect.height, spacingX, spacingY);
+
+	out.resize(std::size_t(width) * height);
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			// Like the nearest segment search, the distance is the maximum value if there is no segment
+			const double value = seeds[std::size_t(i + marginY) * seedRect.width + j + marginX];
+			out[std::size_t(i) * width + j] = (value < std::numeric_limits<double>::infinity()) ? std::sqrt(value) : std::numeric_limits<double>::max();
+		}
+	}
+}
+
+/// <summary>
+/// Evaluate the Lichtenberg figure on a tile of a raster covering the noise domain.
+/// Pixels are evaluated exactly like evaluateLichtenberg, but the levels are
+/// only built once per cell and shared by all the pixels of the cell.
+/// </summary>
+/// <param name="rect">Pixels of the raster to evaluate</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::evaluateLichtenbergTile(const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	out.resize(std::size_t(rect.width) * rect.height);
+
+	PrefetchControlFunction(TilePixel(rect.top, rect.left, width, height), TilePixel(rect.top + rect.height, rect.left + rect.width, width, height));
+
+	WithLevels([&](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		for (const int index : TileTraversalOrder(rect, width, height, m_resolution))
+		{
+			const Point2D pixel = TilePixel(rect.top + index / rect.width, rect.left + index % rect.width, width, height);
+
+			BuildLichtenbergHierarchy(pixel.x, pixel.y, hierarchy);
+			out[index] = ComputeLichtenbergValue(pixel.x, pixel.y, hierarchy);
+		}
+	});
+}
+
+/// <summary>
+/// Evaluate the Lichtenberg figure on a tile of a raster covering the noise domain,
+/// for all the numbers of levels from 1 to the resolution of the noise at once.
+/// The figure with L levels is a by-product of the figure with L + 1 levels, so the
+/// hierarchy is built once, and the figures are exactly those evaluateLichtenbergTile
+/// gives for noises with the same parameters and resolutions 1 to the resolution of the noise.
+/// </summary>
+/// <param name="rect">Pixels of the raster to evaluate</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="out">Values of the pixels of the tile, row by row, for 1 level, then 2 levels, and so on</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::evaluateLichtenbergLevelsTile(const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	assert(m_resolution >= 1 && m_resolution <= MAX_LEVELS);
+
+	const std::size_t area = std::size_t(rect.width) * rect.height;
+	out.resize(area * m_resolution);
+
+	PrefetchControlFunction(TilePixel(rect.top, rect.left, width, height), TilePixel(rect.top + rect.height, rect.left + rect.width, width, height));
+
+	WithLevels([&](auto depth) {
+		Hierarchy<decltype(depth)::value> hierarchy;
+		for (const int index : TileTraversalOrder(rect, width, height, m_resolution))
+		{
+			const Point2D pixel = TilePixel(rect.top + index / rect.width, rect.left + index % rect.width, width, height);
+
+			BuildLichtenbergHierarchy(pixel.x, pixel.y, hierarchy);
+			ComputeLichtenbergLevels<1>(pixel.x, pixel.y, hierarchy, 0.0, std::numeric_limits<double>::max(), area, out.data() + index);
+		}
+	});
+}
+
+/// <summary>
+/// Call f with the number of levels of the noise as a compile-time constant,
+/// so that the evaluation is compiled for each number of levels.
+/// </summary>
+/// <param name="f">Function taking a std::integral_constant with the number of levels</param>
+template <typename I, typename T, typename Display>
+template <int Depth, typename F>
+auto Noise<I, T, Display>::WithLevels(F&& f) const
+{
+	if constexpr (Depth < MAX_LEVELS)
+	{
+		if (m_resolution > Depth)
+		{
+			return WithLevels<Depth + 1>(std::forward<F>(f));
+		}
+	}
+
+	return f(std::integral_constant<int, Depth>());
+}
+
+/// <summary>
+/// Build the levels L to Depth of the hierarchy around the point (x, y).
+/// A level is only rebuilt if the point is not in the same cell as the one used to build it.
+/// </summary>
+/// <typeparam name="S">Strategy used to connect points to segments</typeparam>
+/// <typeparam name="L">First level to build, the levels 1 to L - 1 are already built for (x, y)</typeparam>
+/// <param name="x">x coordinate of the point</param>
+/// <param name="y">y coordinate of the point</param>
+/// <param name="hierarchy">The levels built for the previous point, updated for (x, y)</param>
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, int L, int Depth>
+void Noise<I, T, Display>::BuildLevels(double x, double y, Hierarchy<Depth>& hierarchy) const
+{
+	typedef LevelDescriptor<L> Descriptor;
+
+	Level<L>& level = hierarchy.template get<L>();
+
+	// In which cell of the level is the point (x, y)
+	const Cell cell = GetCell(x, y, Descriptor::resolution);
+	if (hierarchy.levels < L || cell != level.cell)
+	{
+		hierarchy.levels = L - 1;
+
+		// The level only depends on its cell, it may have been built for another point
+		if (!FindCachedLevel<S>(cell, level))
+		{
+			level.cell = cell;
+			// Points in neighboring cells
+			level.points = GenerateNeighboringPoints<Descriptor::points>(cell);
+
+			if constexpr (L == 1)
+			{
+				// List of segments
+				const Segment3DChainArray<Descriptor::points - 2, 1> straightSegments = GenerateSegments(level.points, m_context.cellFootprint[L - 1]);
+				// Subdivide segments of level 1
+				SubdivideSegments(cell, straightSegments, level.segments);
+			}
+			else
+			{
+				const Level<L - 1>& parent = hierarchy.template get<L - 1>();
+				ReplaceNeighboringPoints(parent.cell, parent.points, cell, level.points);
+				// Only rivers have a minimum slope
+				const double minSlope = (S == ConnectionStrategy::Rivers) ? Descriptor::riversMinSlope : 0.0;
+				// Connect the points to the segments of the coarser levels
+				level.segments = std::apply([&](const auto&... tail) {
+					return GenerateSubSegments<S, Descriptor::points, Descriptor::chain>(minSlope, m_context.cellFootprint[L - 1], level.points, tail...);
+				}, hierarchy.template cellsAndSegments<L - 1>());
+			}
+
+			if constexpr (Descriptor::displacementDivisor > 0)
+			{
+				DisplaceSegments(m_displacement / Descriptor::displacementDivisor, cell, level.segments);
+			}
+
+			level.segments.project();
+
+			StoreCachedLevel<S>(level);
+		}
+
+		hierarchy.levels = L;
+	}
+
+	if constexpr (L < Depth)
+	{
+		BuildLevels<S, L + 1>(x, y, hierarchy);
+	}
+}
+
+template <typename I, typename T, typename Display>
+template <int Depth>
+void Noise<I, T, Display>::BuildTerrainHierarchy(double x, double y, bool primitives, Hierarchy<Depth>& hierarchy) const
+{
+	const SegmentGraph* graph = GetRiverGraph();
+	if (graph != nullptr && graph->contains(x, y))
+	{
+		BuildLevelsFromGraph<1>(x, y, *graph, hierarchy);
+	}
+	else
+	{
+		BuildLevelsFromField<ConnectionStrategy::Rivers>(x, y, hierarchy);
+	}
+
+	if (primitives)
+	{
+		const Level<Depth>& level = hierarchy.template get<Depth>();
+
+		std::apply([&](const auto&... tail) {
+			BuildPrimitives(x, y, level.cell, level.points, hierarchy.primitives, tail...);
+		}, hierarchy.template cellsAndSegments<Depth>());
+	}
+}
+
+/// <summary>
+/// Hits, misses and evictions of the level cache since the noise was constructed
+/// </summary>
+template <typename I, typename T, typename Display>
+LevelCacheStatistics Noise<I, T, Display>::levelCacheStatistics() const
+{
+	LevelCacheStatistics statistics;
+	statistics.hits = m_levelCacheHits.load(std::memory_order_relaxed);
+	statistics.misses = m_levelCacheMisses.load(std::memory_order_relaxed);
+	statistics.evictions = m_levelCacheEvictions.load(std::memory_order_relaxed);
+
+	return statistics;
+}
+
+template <typename I, typename T, typename Display>
+std::size_t Noise<I, T, Display>::LevelCacheSlotIndex(ConnectionStrategy S, const Cell& cell) const
+{
+	const uint64_t packed = (uint64_t(uint32_t(cell.x)) << 32) | uint64_t(uint32_t(cell.y));
+	const uint64_t level = (uint64_t(uint32_t(cell.resolution)) << 8) | uint64_t(S);
+
+	return std::size_t(MixBits(packed ^ MixBits(level))) & (m_levelCacheCapacity - 1);
+}
+
+/// <summary>
+/// Copy the level L built in a cell with the strategy S from the level cache
+/// </summary>
+/// <param name="cell">Cell of the level</param>
+/// <param name="level">Level, set only if it is in the cache</param>
+/// <returns>True if the level is in the cache</returns>
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, int L>
+bool Noise<I, T, Display>::FindCachedLevel(const Cell& cell, Level<L>& level) const
+{
+	if (m_levelCacheCapacity == 0)
+	{
+		return false;
+	}
+
+	const std::size_t slot = LevelCacheSlotIndex(S, cell);
+
+	bool found = false;
+	{
+		const std::lock_guard<std::mutex> lock(m_levelCacheMutexes[slot % LEVEL_CACHE_MUTEXES]);
+
+		const LevelCacheSlot<L>& entry = std::get<L - 1>(m_levelCache)[slot];
+		if (entry.level != nullptr && entry.strategy == S && entry.level->cell == cell)
+		{
+			level = *entry.level;
+			found = true;
+		}
+	}
+
+	(found ? m_levelCacheHits : m_levelCacheMisses).fetch_add(1, std::memory_order_relaxed);
+
+	return found;
+}
+
+/// <summary>
+/// Store the level L built with the strategy S in the level cache, replacing the level stored in its slot
+/// </summary>
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, int L>
+void Noise<I, T, Display>::StoreCachedLevel(const Level<L>& level) const
+{
+	if (m_levelCacheCapacity == 0)
+	{
+		return;
+	}
+
+	const std::size_t slot = LevelCacheSlotIndex(S, level.cell);
+
+	const std::lock_guard<std::mutex> lock(m_levelCacheMutexes[slot % LEVEL_CACHE_MUTEXES]);
+
+	LevelCacheSlot<L>& entry = std::get<L - 1>(m_levelCache)[slot];
+	if (entry.level == nullptr)
+	{
+		entry.level = std::make_unique<Level<L> >(level);
+	}
+	else
+	{
+		if (entry.strategy != S || entry.level->cell != level.cell)
+		{
+			m_levelCacheEvictions.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		*entry.level = level;
+	}
+
+	entry.strategy = S;
+}
+
+/// <summary>
+/// Bounds of a segment graph of the levels 1 to levels over the noise domain.
+/// A graph is only built if the domain is finite and has less than RIVER_GRAPH_MAX_CELLS cells,
+/// counting the cells of the points around the domain like BuildSegmentGraph.
+/// </summary>
+/// <param name="levels">Number of levels of the graph</param>
+/// <param name="minimum">Minimum corner of the domain</param>
+/// <param name="maximum">Maximum corner of the domain</param>
+/// <returns>True if the graph should be built, false if the levels should be generated for each point</returns>
+template <typename I, typename T, typename Display>
+bool Noise<I, T, Display>::GetSegmentGraphBounds(int levels, Point2D& minimum, Point2D& maximum) const
+{
+	minimum = Point2D(std::min(m_noiseTopLeft.x, m_noiseBottomRight.x), std::min(m_noiseTopLeft.y, m_noiseBottomRight.y));
+	maximum = Point2D(std::max(m_noiseTopLeft.x, m_noiseBottomRight.x), std::max(m_noiseTopLeft.y, m_noiseBottomRight.y));
+	if (!std::isfinite(minimum.x) || !std::isfinite(minimum.y) || !std::isfinite(maximum.x) || !std::isfinite(maximum.y))
+	{
+		return false;
+	}
+
+	// Cells of all the levels, with the points around the domain
+	double cells = 0.0;
+	for (int level = 0; level < levels; level++)
+	{
+		const int resolution = 1 << level;
+		const double margin = 2.0 * ((level == 0) ? LevelDescriptor<1>::points / 2 : LevelDescriptor<2>::points / 2) + 1.0;
+		cells += (std::floor(maximum.x * resolution) - std::floor(minimum.x * resolution) + margin) * (std::floor(maximum.y * resolution) - std::floor(minimum.y * resolution) + margin);
+	}
+
+	return cells <= RIVER_GRAPH_MAX_CELLS;
+}
+
+/// <summary>
+/// River graph of the terrain over the noise domain, built on the first call.
+/// The graph is only built if GetSegmentGraphBounds accepts the domain.
+/// </summary>
+/// <returns>The graph, nullptr if the levels should be generated for each point</returns>
+template <typename I, typename T, typename Display>
+const typename Noise<I, T, Display>::SegmentGraph* Noise<I, T, Display>::GetRiverGraph() const
+{
+	std::call_once(m_riverGraphBuilt, [this]() {
+		Point2D minimum, maximum;
+		if (!GetSegmentGraphBounds(m_resolution, minimum, maximum))
+		{
+			return;
+		}
+
+		std::unique_ptr<SegmentGraph> graph = std::make_unique<SegmentGraph>();
+		graph->minimum = minimum;
+		graph->maximum = maximum;
+
+		WithLevels([&](auto depth) {
+			BuildSegmentGraph<ConnectionStrategy::Rivers, 1, decltype(depth)::value>(*graph);
+			return 0;
+		});
+
+		m_riverGraph = std::move(graph);
+	});
+
+	return m_riverGraph.get();
+}
+
+/// <summary>
+/// Level 1 of the noise over the noise domain, built on the first call. The level 1 only depends on
+/// the cells, so it is shared by all the points of the domain, whatever the strategy of the levels.
+/// The field is only built if GetSegmentGraphBounds accepts the domain for one level.
+/// </summary>
+/// <returns>The field, nullptr if the level 1 should be generated for each point</returns>
+template <typename I, typename T, typename Display>
+const typename Noise<I, T, Display>::SegmentGraph* Noise<I, T, Display>::GetLevelOneField() const
+{
+	std::call_once(m_levelOneFieldBuilt, [this]() {
+		Point2D minimum, maximum;
+		if (!GetSegmentGraphBounds(1, minimum, maximum))
+		{
+			return;
+		}
+
+		std::unique_ptr<SegmentGraph> field = std::make_unique<SegmentGraph>();
+		field->minimum = minimum;
+		field->maximum = maximum;
+
+		// The strategy only connects the points of the levels from 2
+		BuildSegmentGraph<ConnectionStrategy::Rivers, 1, 1>(*field);
+
+		m_levelOneField = std::move(field);
+	});
+
+	return m_levelOneField.get();
+}
+
+/// <summary>
+/// Build the levels 1 to Depth of the hierarchy around the point (x, y) like BuildLevels,
+/// with the level 1 read from the level 1 field when it contains the point.
+/// </summary>
+/// <typeparam name="S">Strategy used to connect points to segments</typeparam>
+/// <param name="hierarchy">The levels built for the previous point, updated for (x, y)</param>
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, int Depth>
+void Noise<I, T, Display>::BuildLevelsFromField(double x, double y, Hierarchy<Depth>& hierarchy) const
+{
+	const SegmentGraph* field = GetLevelOneField();
+	if (field == nullptr || !field->contains(x, y))
+	{
+		BuildLevels<S, 1>(x, y, hierarchy);
+		return;
+	}
+
+	BuildLevelsFromGraph<1, Depth, 1>(x, y, *field, hierarchy);
+
+	if constexpr (Depth > 1)
+	{
+		BuildLevels<S, 2>(x, y, hierarchy);
+	}
+}
+
+/// <summary>
+/// Build the levels L to Depth of a segment graph over its region.
+/// A hierarchy built in a cell gives the points and the chains of the 5 x 5 cells around it,
+/// so hierarchies are built every 5 cells.
+/// </summary>
+/// <typeparam name="S">Strategy used to connect points to segments</typeparam>
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, int L, int Depth>
+void Noise<I, T, Display>::BuildSegmentGraph(SegmentGraph& graph) const
+{
+	typedef LevelDescriptor<L> Descriptor;
+
+	// Cells of the segment chain arrays around the cell of a hierarchy
+	const int chains = 5;
+
+	LevelGraph<L>& level = graph.template get<L>();
+
+	// Cells of the domain, and of the points around it
+	const Cell first = GetCell(graph.minimum.x, graph.minimum.y, Descriptor::resolution);
+	const Cell last = GetCell(graph.maximum.x, graph.maximum.y, Descriptor::resolution);
+	const int margin = int(Descriptor::points) / 2;
+
+	level.x = first.x - margin;
+	level.y = first.y - margin;
+	level.width = last.x - first.x + 1 + 2 * margin;
+	level.height = last.y - first.y + 1 + 2 * margin;
+	level.points.resize(std::size_t(level.width) * level.height);
+	level.chains.resize(std::size_t(level.width) * level.height);
+
+	Hierarchy<L> hierarchy;
+	for (int y = level.y + chains / 2; y - chains / 2 < level.y + level.height; y += chains)
+	{
+		for (int x = level.x + chains / 2; x - chains / 2 < level.x + level.width; x += chains)
+		{
+			// Levels of the center of the cell (x, y)
+			BuildLevels<S, 1>((x + 0.5) / Descriptor::resolution, (y + 0.5) / Descriptor::resolution, hierarchy);
+
+			const Level<L>& built = hierarchy.template get<L>();
+			for (int i = 0; i < chains; i++)
+			{
+				for (int j = 0; j < chains; j++)
+				{
+					const int cellX = x + j - chains / 2;
+					const int cellY = y + i - chains / 2;
+					if (cellX < level.x + level.width && cellY < level.y + level.height)
+					{
+						const std::size_t index = level.index(cellX, cellY);
+						level.points[index] = built.points[margin + i - chains / 2][margin + j - chains / 2];
+						level.chains[index] = built.segments[i][j];
+					}
+				}
+			}
+		}
+	}
+
+	if constexpr (L < Depth)
+	{
+		BuildSegmentGraph<S, L + 1, Depth>(graph);
+	}
+}
+
+/// <summary>
+/// Build the levels L to Last of the hierarchy around the point (x, y) from a segment graph,
+/// like BuildLevels with the strategy of the graph.
+/// </summary>
+/// <param name="graph">Segment graph containing the point</param>
+/// <param name="hierarchy">The levels built for the previous point, updated for (x, y)</param>
+template <typename I, typename T, typename Display>
+template <int L, int Depth, int Last>
+void Noise<I, T, Display>::BuildLevelsFromGraph(double x, double y, const SegmentGraph& graph, Hierarchy<Depth>& hierarchy) const
+{
+	typedef LevelDescriptor<L> Descriptor;
+
+	Level<L>& level = hierarchy.template get<L>();
+
+	const Cell cell = GetCell(x, y, Descriptor::resolution);
+	if (hierarchy.levels < L || cell != level.cell)
+	{
+		hierarchy.levels = L - 1;
+		level.cell = cell;
+
+		const LevelGraph<L>& graphLevel = graph.template get<L>();
+
+		const int points = int(Descriptor::points);
+		for (int i = 0; i < points; i++)
+		{
+			for (int j = 0; j < points; j++)
+			{
+				level.points[i][j] = graphLevel.points[graphLevel.index(cell.x + j - points / 2, cell.y + i - points / 2)];
+			}
+		}
+
+		const int chains = int(level.segments.size());
+		for (int i = 0; i < chains; i++)
+		{
+			for (int j = 0; j < chains; j++)
+			{
+				level.segments[i][j] = graphLevel.chains[graphLevel.index(cell.x + j - chains / 2, cell.y + i - chains / 2)];
+			}
+		}
+
+		level.segments.project();
+		hierarchy.levels = L;
+	}
+
+	if constexpr (L < Last)
+	{
+		BuildLevelsFromGraph<L + 1, Depth, Last>(x, y, graph, hierarchy);
+	}
+}
+
+/// <summary>
+/// Set to 0 the pixels of a rectangle of a raster covering the noise domain that are within half a pixel diagonal
+/// of the segments of the levels L to Depth of the river graph. The rectangle may extend beyond the raster.
+/// </summary>
+/// <param name="rect">Rectangle of pixels</param>
+/// <param name="width">Width of the raster</param>
+/// <param name="height">Height of the raster</param>
+/// <param name="seeds">Values of the pixels of the rectangle, row by row</param>
+template <typename I, typename T, typename Display>
+template <int L, int Depth>
+void Noise<I, T, Display>::RasterizeSegments(const SegmentGraph& graph, const TileRect& rect, int width, int height, std::vector<double>& seeds) const
+{
+	// Signed size of a pixel in the noise domain
+	const double stepX = (m_noiseBottomRight.x - m_noiseTopLeft.x) / width;
+	const double stepY = (m_noiseBottomRight.y - m_noiseTopLeft.y) / height;
+	const double radius = std::hypot(stepX, stepY) / 2.0;
+
+	for (const auto& chain : graph.template get<L>().chains)
+	{
+		for (const Segment3DT<T>& segment : chain)
+		{
+			const Point2D a(double(segment.a.x), double(segment.a.y));
+			const Point2D b(double(segment.b.x), double(segment.b.y));
+
+			// Segments of null length are never the nearest segment of a point, and invalid segments have no pixels
+			if (a == b || !std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(b.x) || !std::isfinite(b.y))
+			{
+				continue;
+			}
+
+			// Pixels in the bounding box of the segment, enlarged by the radius
+			const double jA = (std::min(a.x, b.x) - radius - m_noiseTopLeft.x) / stepX;
+			const double jB = (std::max(a.x, b.x) + radius - m_noiseTopLeft.x) / stepX;
+			const double iA = (std::min(a.y, b.y) - radius - m_noiseTopLeft.y) / stepY;
+			const double iB = (std::max(a.y, b.y) + radius - m_noiseTopLeft.y) / stepY;
+
+			const int jMin = int(std::max(std::ceil(std::min(jA, jB)), double(rect.left)));
+			const int jMax = int(std::min(std::floor(std::max(jA, jB)), double(rect.left + rect.width - 1)));
+			const int iMin = int(std::max(std::ceil(std::min(iA, iB)), double(rect.top)));
+			const int iMax = int(std::min(std::floor(std::max(iA, iB)), double(rect.top + rect.height - 1)));
+
+			for (int i = iMin; i <= iMax; i++)
+			{
+				for (int j = jMin; j <= jMax; j++)
+				{
+					// Pixels beyond the raster are not clamped, unlike TilePixel
+					const Point2D pixel(m_noiseTopLeft.x + j * stepX, m_noiseTopLeft.y + i * stepY);
+
+					Point2D c;
+					if (distToLineSegment(pixel, a, b, c) <= radius)
+					{
+						seeds[std::size_t(i - rect.top) * rect.width + j - rect.left] = 0.0;
+					}
+				}
+			}
+		}
+	}
+
+	if constexpr (L < Depth)
+	{
+		RasterizeSegments<L + 1, Depth>(graph, rect, width, height, seeds);
+	}
+}
+
+/// <summary>
+/// Draw the levels L to Depth of a segment graph on a tile, like ComputeColor displays them
+/// </summary>
+/// <param name="graph">Segment graph around the tile</param>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+template <int L, int Depth>
+void Noise<I, T, Display>::DrawLevels(const SegmentGraph& graph, const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	const LevelGraph<L>& level = graph.template get<L>();
+
+	const double radius = m_context.displayRadius[L - 1];
+
+	if (m_display.points())
+	{
+		for (const Point2D& point : level.points)
+		{
+			DrawDisk(point, radius, rect, width, height, out);
+		}
+
+		for (const auto& chain : level.chains)
+		{
+			for (const Point3DT<T>& point : chain.points)
+			{
+				DrawDisk(Point2D(ProjectionZ(point)), radius / 2.0, rect, width, height, out);
+			}
+		}
+	}
+
+	if (m_display.segments())
+	{
+		for (const auto& chain : level.chains)
+		{
+			for (const Segment3DT<T>& segment : chain)
+			{
+				const Point2D a(double(segment.a.x), double(segment.a.y));
+				const Point2D b(double(segment.b.x), double(segment.b.y));
+
+				// Like ComputeColorSegments, segments of null length are not displayed
+				if (!(a == b))
+				{
+					DrawStroke(a, b, radius / 4.0, radius / 4.0, rect, width, height, out);
+				}
+			}
+		}
+	}
+
+	if (m_display.grid())
+	{
+		// Lines between the cells of the level
+		const int resolution = LevelDescriptor<L>::resolution;
+		for (int k = int(std::ceil(graph.minimum.x * resolution)); k <= int(std::floor(graph.maximum.x * resolution)); k++)
+		{
+			const double x = double(k) / resolution;
+			DrawStroke(Point2D(x, graph.minimum.y), Point2D(x, graph.maximum.y), radius / 8.0, 0.0, rect, width, height, out);
+		}
+
+		for (int k = int(std::ceil(graph.minimum.y * resolution)); k <= int(std::floor(graph.maximum.y * resolution)); k++)
+		{
+			const double y = double(k) / resolution;
+			DrawStroke(Point2D(graph.minimum.x, y), Point2D(graph.maximum.x, y), radius / 8.0, 0.0, rect, width, height, out);
+		}
+	}
+
+	if constexpr (L < Depth)
+	{
+		DrawLevels<L + 1, Depth>(graph, rect, width, height, out);
+	}
+}
+
+/// <summary>
+/// Draw on a tile the rectangle around the segment [a, b], keeping for each pixel the maximum of its value
+/// and of the area of its footprint covered by the rectangle. The footprint is a square of the area of a pixel.
+/// </summary>
+/// <param name="halfWidth">Half the width of the rectangle</param>
+/// <param name="extension">Length of the rectangle beyond a and b</param>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::DrawStroke(const Point2D& a, const Point2D& b, double halfWidth, double extension, const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	// Signed size of a pixel in the noise domain
+	const double stepX = (m_noiseBottomRight.x - m_noiseTopLeft.x) / width;
+	const double stepY = (m_noiseBottomRight.y - m_noiseTopLeft.y) / height;
+	const double footprint = std::sqrt(std::abs(stepX * stepY));
+
+	const double length = dist(a, b);
+	const Vec2D axis = (length > 0.0) ? Vec2D(a, b) / length : Vec2D(1.0, 0.0);
+
+	// Pixels whose center is near enough for their footprint to overlap the rectangle
+	const double reach = halfWidth + extension + footprint;
+	const double jA = (std::min(a.x, b.x) - reach - m_noiseTopLeft.x) / stepX - 0.5;
+	const double jB = (std::max(a.x, b.x) + reach - m_noiseTopLeft.x) / stepX - 0.5;
+	const double iA = (std::min(a.y, b.y) - reach - m_noiseTopLeft.y) / stepY - 0.5;
+	const double iB = (std::max(a.y, b.y) + reach - m_noiseTopLeft.y) / stepY - 0.5;
+
+	const int jMin = int(std::max(std::ceil(std::min(jA, jB)), double(rect.left)));
+	const int jMax = int(std::min(std::floor(std::max(jA, jB)), double(rect.left + rect.width - 1)));
+	const int iMin = int(std::max(std::ceil(std::min(iA, iB)), double(rect.top)));
+	const int iMax = int(std::min(std::floor(std::max(iA, iB)), double(rect.top + rect.height - 1)));
+
+	for (int i = iMin; i <= iMax; i++)
+	{
+		for (int j = jMin; j <= jMax; j++)
+		{
+			const Point2D center(m_noiseTopLeft.x + (j + 0.5) * stepX, m_noiseTopLeft.y + (i + 0.5) * stepY);
+
+			// Coordinates of the center of the pixel along the segment and across it
+			const Vec2D ac(a, center);
+			const double along = dot(ac, axis);
+			const double across = cross(axis, ac);
+
+			const double coverage = BoxCoverage(-extension - along, length + extension - along, footprint) * BoxCoverage(-halfWidth - across, halfWidth - across, footprint);
+
+			double& value = out[std::size_t(i - rect.top) * rect.width + (j - rect.left)];
+			value = std::max(value, coverage);
+		}
+	}
+}
+
+/// <summary>
+/// Draw a disk on a tile, keeping for each pixel the maximum of its value and of the area of its footprint
+/// covered by the disk. Across the direction to the center, the disk is replaced by its mean chord, so the
+/// coverage is exact for the pixels far inside the disk or on its boundary, and for disks much smaller than a pixel.
+/// </summary>
+/// <param name="out">Values of the pixels of the tile, row by row</param>
+template <typename I, typename T, typename Display>
+void Noise<I, T, Display>::DrawDisk(const Point2D& center, double radius, const TileRect& rect, int width, int height, std::vector<double>& out) const
+{
+	// Signed size of a pixel in the noise domain
+	const double stepX = (m_noiseBottomRight.x - m_noiseTopLeft.x) / width;
+	const double stepY = (m_noiseBottomRight.y - m_noiseTopLeft.y) / height;
+	const double footprint = std::sqrt(std::abs(stepX * stepY));
+
+	// Half the mean chord of the disk
+	const double chord = std::acos(-1.0) * radius / 4.0;
+
+	// Pixels whose center is near enough for their footprint to overlap the disk
+	const double reach = radius + footprint;
+	const double jA = (center.x - reach - m_noiseTopLeft.x) / stepX - 0.5;
+	const double jB = (center.x + reach - m_noiseTopLeft.x) / stepX - 0.5;
+	const double iA = (center.y - reach - m_noiseTopLeft.y) / stepY - 0.5;
+	const double iB = (center.y + reach - m_noiseTopLeft.y) / stepY - 0.5;
+
+	const int jMin = int(std::max(std::ceil(std::min(jA, jB)), double(rect.left)));
+	const int jMax = int(std::min(std::floor(std::max(jA, jB)), double(rect.left + rect.width - 1)));
+	const int iMin = int(std::max(std::ceil(std::min(iA, iB)), double(rect.top)));
+	const int iMax = int(std::min(std::floor(std::max(iA, iB)), double(rect.top + rect.height - 1)));
+
+	for (int i = iMin; i <= iMax; i++)
+	{
+		for (int j = jMin; j <= jMax; j++)
+		{
+			const Point2D pixel(m_noiseTopLeft.x + (j + 0.5) * stepX, m_noiseTopLeft.y + (i + 0.5) * stepY);
+			const double d = dist(center, pixel);
+
+			const double coverage = BoxCoverage(-radius - d, radius - d, footprint) * BoxCoverage(-chord, chord, footprint);
+
+			double& value = out[std::size_t(i - rect.top) * rect.width + (j - rect.left)];
+			value = std::max(value, coverage);
+		}
+	}
 }
 
-template <typename I>
-double Noise<I>::ComputeColorBase(double dist, double radius) const
+/// <summary>
+/// Part of the interval [-footprint / 2, footprint / 2] covered by [lower, upper]
+/// </summary>
+template <typename I, typename T, typename Display>
+double Noise<I, T, Display>::BoxCoverage(double lower, double upper, double footprint) const
 {
-	if (dist < radius)
-	{
-		return 1.0;
-	}
+	const double covered = std::min(upper, footprint / 2.0) - std::max(lower, -footprint / 2.0);
 
-	return 0.0;
+	return std::max(covered, 0.0) / footprint;
 }
 
-template <typename I>
-double Noise<I>::ComputeColorPoint(double x, double y, const Point2D& point, double radius) const
+template <typename I, typename T, typename Display>
+template <int Depth>
+void Noise<I, T, Display>::BuildLichtenbergHierarchy(double x, double y, Hierarchy<Depth>& hierarchy) const
 {
-	const double d = dist(Point2D(x, y), point);
-	return ComputeColorBase(d, radius);
+	BuildLevelsFromField<ConnectionStrategy::AngleMid>(x, y, hierarchy);
 }
 
-template <typename I>
-double Noise<I>::ComputeColorSegment(double x, double y, const Segment2D& segment, double radius) const
+template <typename I, typename T, typename Display>
+template <int Depth>
+double Noise<I, T, Display>::ComputeTerrainValue(double x, double y, const Hierarchy<Depth>& hierarchy) const
 {
-	Point2D c;
-	const double d = distToLineSegment(Point2D(x, y), segment, c);
-	return ComputeColorBase(d, radius);
-}
+	const auto cellsAndSegments = hierarchy.template cellsAndSegments<Depth>();
 
-template <typename I>
-double Noise<I>::ComputeColorGrid(double x, double y, double deltaX, double deltaY, double radius) const
-{
 	double value = 0.0;
 
-	// When near to the grid
-	if (std::abs(x - floor(x) - deltaX) < radius || std::abs(y - floor(y) - deltaY) < radius)
+	if (m_display.function())
 	{
-		value = 1.0;
+		value = std::max(value, ComputeColorPrimitives(x, y, hierarchy.primitives));
+	}
+
+	if (m_display.points() || m_display.segments() || m_display.grid())
+	{
+		value = std::max(value, std::apply([&](const auto&... tail) {
+			return ComputeColor(x, y, tail...);
+		}, hierarchy.template cellsSegmentsAndPoints<Depth>()));
+	}
+
+	if (m_display.distance())
+	{
+		const double distance = std::apply([&](const auto&... tail) {
+			return ComputeColorDistance(x, y, tail...);
+		}, cellsAndSegments);
+
+		// From level 2, the distance replaces the other outputs
+		value = (Depth == 1) ? std::max(value, distance) : distance;
 	}
 
 	return value;
 }
 
-template <typename I>
-double Noise<I>::evaluateTerrain(double x, double y) const
+template <typename I, typename T, typename Display>
+template <int Depth>
+double Noise<I, T, Display>::ComputeTerrainValueWithGradient(double x, double y, const Hierarchy<Depth>& hierarchy, double& dx, double& dy) const
 {
-	assert(m_resolution >= 1 && m_resolution <= 5);
-
-	const ConnectionStrategy connectionStrategy = ConnectionStrategy::Rivers;
-	const double minSlopeLevel2 = 0.09;
-	const double minSlopeLevel3 = 0.18;
-	const double minSlopeLevel4 = 0.38;
-	const double minSlopeLevel5 = 1.0;
-	const double displacementLevel1 = m_displacement;
-	const double displacementLevel2 = displacementLevel1 / 4;
-	const double displacementLevel3 = displacementLevel2 / 4;
+	const auto cellsAndSegments = hierarchy.template cellsAndSegments<Depth>();
 
 	double value = 0.0;
+	dx = 0.0;
+	dy = 0.0;
 
-	// In which level 1 cell is the point (x, y)
-	Cell cell1 = GetCell(x, y, 1);
-	// Level 1: Points in neighboring cells
-	Point2DArray<9> points1 = GenerateNeighboringPoints<9>(cell1);
-	// Level 1: List of segments
-	const Segment3DChainArray<7, 1> straightSegments1 = GenerateSegments(points1);
-	// Subdivide segments of level 1
-	Segment3DChainArray<5, 4> segments1;
-	SubdivideSegments(cell1, straightSegments1, segments1);
-	DisplaceSegments(displacementLevel1, cell1, segments1);
-
-	if (m_resolution == 1)
+	// The gradient is the one of the output giving the value
+	if (m_display.function())
 	{
-		if (m_displayFunction)
-		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell1, points1, cell1, segments1));
-		}
-		
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
+		double primitivesDx, primitivesDy;
+		const double primitives = ComputeColorPrimitivesWithGradient(x, y, hierarchy.primitives, primitivesDx, primitivesDy);
+		if (value < primitives)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1));
+			value = primitives;
+			dx = primitivesDx;
+			dy = primitivesDy;
 		}
-		
-		if (m_displayDistance)
-		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1));
-		}
-
-		return value;
 	}
 
-	// In which level 2 cell is the point (x, y)
-	Cell cell2 = GetCell(x, y, 2);
-	// Level 2: Points in neighboring cells
-	Point2DArray<5> points2 = GenerateNeighboringPoints<5>(cell2);
-	ReplaceNeighboringPoints(cell1, points1, cell2, points2);
-	// Level 2: List of segments
-	Segment3DChainArray<5, 3> segments2 = GenerateSubSegments<5, 3>(connectionStrategy, minSlopeLevel2, points2, cell1, segments1);
-	DisplaceSegments(displacementLevel2, cell2, segments2);
-
-	if (m_resolution == 2)
+	if (m_display.points() || m_display.segments() || m_display.grid())
 	{
-		if (m_displayFunction)
+		const double color = std::apply([&](const auto&... tail) {
+			return ComputeColor(x, y, tail...);
+		}, hierarchy.template cellsSegmentsAndPoints<Depth>());
+		if (value < color)
 		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell2, points2, cell1, segments1, cell2, segments2));
+			value = color;
+			dx = 0.0;
+			dy = 0.0;
 		}
-
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2));
-		}
-
-		if (m_displayDistance)
-		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2);
-		}
-
-		return value;
 	}
-	
-	// In which level 3 cell is the point (x, y)
-	Cell cell3 = GetCell(x, y, 4);
-	// Level 3: Points in neighboring cells
-	Point2DArray<5> points3 = GenerateNeighboringPoints<5>(cell3);
-	ReplaceNeighboringPoints(cell2, points2, cell3, points3);
-	// Level 3: List of segments
-	Segment3DChainArray<5, 2> segments3 = GenerateSubSegments<5, 2>(connectionStrategy, minSlopeLevel3, points3, cell1, segments1, cell2, segments2);
-	DisplaceSegments(displacementLevel3, cell3, segments3);
-
-	if (m_resolution == 3)
-	{
-		if (m_displayFunction)
-		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell3, points3, cell1, segments1, cell2, segments2, cell3, segments3));
-		}
 
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3));
-		}
+	if (m_display.distance())
+	{
+		double distanceDx, distanceDy;
+		const double distance = std::apply([&](const auto&... tail) {
+			return ComputeColorDistanceWithGradient(x, y, distanceDx, distanceDy, tail...);
+		}, cellsAndSegments);
 
-		if (m_displayDistance)
+		// From level 2, the distance replaces the other outputs
+		if (Depth > 1 || value < distance)
 		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3);
+			value = distance;
+			dx = distanceDx;
+			dy = distanceDy;
 		}
-
-		return value;
 	}
-	
-	// In which level 4 cell is the point (x, y)
-	Cell cell4 = GetCell(x, y, 8);
-	// Level 4: Points in neighboring cells
-	Point2DArray<5> points4 = GenerateNeighboringPoints<5>(cell4);
-	ReplaceNeighboringPoints(cell3, points3, cell4, points4);
-	// Level 4: List of segments
-	Segment3DChainArray<5, 1> segments4 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopeLevel4, points4, cell1, segments1, cell2, segments2, cell3, segments3);
 
-	if (m_resolution == 4)
-	{
-		if (m_displayFunction)
-		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell4, points4, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4));
-		}
+	return value;
+}
 
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4));
-		}
+/// <summary>
+/// Values of the Lichtenberg figure with the levels 1 to L, L + 1, up to Depth, computed like
+/// ComputeLichtenbergValue from the colors and the distances of the coarser levels
+/// </summary>
+/// <param name="color">Maximum of the colors of the levels 1 to L - 1</param>
+/// <param name="distance">Distance to the nearest segment of the levels 1 to L - 1</param>
+/// <param name="stride">Distance between the values of two consecutive levels</param>
+/// <param name="values">Value of the figure with L levels, followed by the values with more levels</param>
+template <typename I, typename T, typename Display>
+template <int L, int Depth>
+void Noise<I, T, Display>::ComputeLichtenbergLevels(double x, double y, const Hierarchy<Depth>& hierarchy, double color, double distance, std::size_t stride, double* values) const
+{
+	const Level<L>& level = hierarchy.template get<L>();
 
-		if (m_displayDistance)
-		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
-		}
+	double value = 0.0;
 
-		return value;
+	if (m_display.points() || m_display.segments() || m_display.grid())
+	{
+		color = std::max(color, ComputeColor(x, y, level.cell, level.segments, level.points));
+		value = std::max(value, color);
 	}
 
-	// In which level 5 cell is the point (x, y)
-	Cell cell5 = GetCell(x, y, 16);
-	// Level 5: Points in neighboring cells
-	Point2DArray<5> points5 = GenerateNeighboringPoints<5>(cell5);
-	ReplaceNeighboringPoints(cell4, points4, cell5, points5);
-	// Level 5: List of segments
-	Segment3DChainArray<5, 1> segments5 = GenerateSubSegments<5, 1>(connectionStrategy, minSlopeLevel5, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
-
-	if (m_resolution == 5)
+	if (m_display.distance())
 	{
-		if (m_displayFunction)
-		{
-			value = std::max(value, ComputeColorPrimitives(x, y, cell5, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5));
-		}
-
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5));
-		}
+		distance = std::min(distance, ComputeColorDistance(x, y, level.cell, level.segments));
+		value = std::max(value, distance);
+	}
 
-		if (m_displayDistance)
-		{
-			value = ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5);
-		}
+	values[0] = value;
 
-		return value;
+	if constexpr (L < Depth)
+	{
+		ComputeLichtenbergLevels<L + 1>(x, y, hierarchy, color, distance, stride, values + stride);
 	}
-
-	return value;
 }
 
-template <typename I>
-double Noise<I>::evaluateLichtenberg(double x, double y) const
+template <typename I, typename T, typename Display>
+template <int Depth>
+TerrainChannels Noise<I, T, Display>::ComputeTerrainChannels(double x, double y, const Hierarchy<Depth>& hierarchy) const
 {
-	assert(m_resolution >= 1 && m_resolution <= 6);
+	TerrainChannels channels;
 
-	const ConnectionStrategy connectionStrategy = ConnectionStrategy::AngleMid;
-	const double displacementLevel1 = m_displacement;
-	const double displacementLevel2 = displacementLevel1 / 4;
-	const double displacementLevel3 = displacementLevel2 / 4;
+	channels.height = std::max(0.0, ComputeColorPrimitives(x, y, hierarchy.primitives));
 
-	double value = 0.0;
+	channels.mask = std::apply([&](const auto&... tail) {
+		return ComputeColorSegmentsMask(x, y, tail...);
+	}, hierarchy.template cellsAndSegments<Depth>());
 
-	// In which level 1 cell is the point (x, y)
-	Cell cell1 = GetCell(x, y, 1);
-	// Level 1: Points in neighboring cells
-	Point2DArray<9> points1 = GenerateNeighboringPoints<9>(cell1);
-	// Level 1: List of segments
-	const Segment3DChainArray<7, 1> straightSegments1 = GenerateSegments(points1);
-	// Subdivide segments of level 1
-	Segment3DChainArray<5, 4> segments1;
-	SubdivideSegments(cell1, straightSegments1, segments1);
-	DisplaceSegments(displacementLevel1, cell1, segments1);
+	// The nearest segment gives the distance, its level and its identifier
+	Cell nearestSegmentCell;
+	Segment3DT<T> nearestSegment;
+	channels.distance = std::apply([&](const auto&... tail) {
+		return NearestSegmentAndCellProjectionZ(1, Point2D(x, y), nearestSegmentCell, nearestSegment, tail...);
+	}, hierarchy.template cellsAndSegments<Depth>());
 
-	if (m_resolution == 1)
+	if (nearestSegmentCell.resolution > 0)
 	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1));
-		}
-
-		if (m_displayDistance)
+		for (int resolution = nearestSegmentCell.resolution; resolution > 0; resolution /= 2)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1));
+			channels.level++;
 		}
 
-		return value;
+		channels.segmentId = SegmentId(nearestSegmentCell.resolution, nearestSegment);
 	}
 
-	// In which level 2 cell is the point (x, y)
-	Cell cell2 = GetCell(x, y, 2);
-	// Level 2: Points in neighboring cells
-	Point2DArray<5> points2 = GenerateNeighboringPoints<5>(cell2);
-	ReplaceNeighboringPoints(cell1, points1, cell2, points2);
-	// Level 2: List of segments
-	Segment3DChainArray<5, 3> segments2 = GenerateSubSegments<5, 3>(connectionStrategy, 0.0, points2, cell1, segments1);
-	DisplaceSegments(displacementLevel2, cell2, segments2);
-
-	if (m_resolution == 2)
-	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2));
-		}
+	return channels;
+}
 
-		if (m_displayDistance)
-		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2));
-		}
+/// <summary>
+/// Identifier of a segment, computed from its level and the exact coordinates of its projection
+/// so that all the cells where the segment is generated give it the same identifier
+/// </summary>
+template <typename I, typename T, typename Display>
+uint64_t Noise<I, T, Display>::SegmentId(int resolution, const Segment3DT<T>& segment) const
+{
+	const double coordinates[4] = { double(segment.a.x), double(segment.a.y), double(segment.b.x), double(segment.b.y) };
 
-		return value;
+	uint64_t id = MixBits(uint64_t(resolution));
+	for (const double coordinate : coordinates)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &coordinate, sizeof(bits));
+		id = MixBits(id ^ bits);
 	}
 
-	// In which level 3 cell is the point (x, y)
-	Cell cell3 = GetCell(x, y, 4);
-	// Level 3: Points in neighboring cells
-	Point2DArray<5> points3 = GenerateNeighboringPoints<5>(cell3);
-	ReplaceNeighboringPoints(cell2, points2, cell3, points3);
-	// Level 3: List of segments
-	Segment3DChainArray<5, 2> segments3 = GenerateSubSegments<5, 2>(connectionStrategy, 0.0, points3, cell1, segments1, cell2, segments2);
-	DisplaceSegments(displacementLevel3, cell3, segments3);
+	return id;
+}
 
-	if (m_resolution == 3)
-	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3));
-		}
+template <typename I, typename T, typename Display>
+template <int Depth>
+double Noise<I, T, Display>::ComputeLichtenbergValue(double x, double y, const Hierarchy<Depth>& hierarchy) const
+{
+	const auto cellsAndSegments = hierarchy.template cellsAndSegments<Depth>();
 
-		if (m_displayDistance)
-		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3));
-		}
+	double value = 0.0;
 
-		return value;
+	if (m_display.points() || m_display.segments() || m_display.grid())
+	{
+		value = std::max(value, std::apply([&](const auto&... tail) {
+			return ComputeColor(x, y, tail...);
+		}, hierarchy.template cellsSegmentsAndPoints<Depth>()));
 	}
 
-	// In which level 4 cell is the point (x, y)
-	Cell cell4 = GetCell(x, y, 8);
-	// Level 4: Points in neighboring cells
-	Point2DArray<5> points4 = GenerateNeighboringPoints<5>(cell4);
-	ReplaceNeighboringPoints(cell3, points3, cell4, points4);
-	// Level 4: List of segments
-	Segment3DChainArray<5, 1> segments4 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points4, cell1, segments1, cell2, segments2, cell3, segments3);
-
-	if (m_resolution == 4)
+	if (m_display.distance())
 	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4));
-		}
+		value = std::max(value, std::apply([&](const auto&... tail) {
+			return ComputeColorDistance(x, y, tail...);
+		}, cellsAndSegments));
+	}
 
-		if (m_displayDistance)
-		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4));
-		}
+	return value;
+}
 
-		return value;
-	}
+/// <summary>
+/// Coordinates of the pixel (i, j) of a raster covering the noise domain
+/// </summary>
+template <typename I, typename T, typename Display>
+Point2D Noise<I, T, Display>::TilePixel(int i, int j, int width, int height) const
+{
+	const double x = remap_clamp(double(j), 0.0, double(width), m_noiseTopLeft.x, m_noiseBottomRight.x);
+	const double y = remap_clamp(double(i), 0.0, double(height), m_noiseTopLeft.y, m_noiseBottomRight.y);
+
+	return { x, y };
+}
 
-	// In which level 5 cell is the point (x, y)
-	Cell cell5 = GetCell(x, y, 16);
-	// Level 5: Points in neighboring cells
-	Point2DArray<5> points5 = GenerateNeighboringPoints<5>(cell5);
-	ReplaceNeighboringPoints(cell4, points4, cell5, points5);
-	// Level 5: List of segments
-	Segment3DChainArray<5, 1> segments5 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points5, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4);
+/// <summary>
+/// Announce to the control function the regions where the points of the levels L and
+/// finer are generated for the pixels in [topLeft, bottomRight], with the footprint
+/// of each level, so that it can load their data before the evaluation.
+/// </summary>
+template <typename I, typename T, typename Display>
+template <int L>
+void Noise<I, T, Display>::PrefetchControlFunction(const Point2D& topLeft, const Point2D& bottomRight) const
+{
+	typedef LevelDescriptor<L> Descriptor;
 
-	if (m_resolution == 5)
+	if (m_controlFunction)
 	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
-		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5));
-		}
+		// Points are generated in the cells around the cell of a pixel
+		const double halo = double(Descriptor::points / 2 + 1) / Descriptor::resolution;
 
-		if (m_displayDistance)
-		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5));
-		}
+		const Point2D a = ToControlFunction(Point2D(std::min(topLeft.x, bottomRight.x) - halo, std::min(topLeft.y, bottomRight.y) - halo));
+		const Point2D b = ToControlFunction(Point2D(std::max(topLeft.x, bottomRight.x) + halo, std::max(topLeft.y, bottomRight.y) + halo));
 
-		return value;
+		m_controlFunction->prefetch(std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y), m_context.cellFootprint[L - 1]);
 	}
 
-	// In which level 6 cell is the point (x, y)
-	Cell cell6 = GetCell(x, y, 32);
-	// Level 6: Points in neighboring cells
-	Point2DArray<5> points6 = GenerateNeighboringPoints<5>(cell6);
-	ReplaceNeighboringPoints(cell5, points5, cell6, points6);
-	// Level 6: List of segments
-	Segment3DChainArray<5, 1> segments6 = GenerateSubSegments<5, 1>(connectionStrategy, 0.0, points6, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5);
-
-	if (m_resolution == 6)
+	if constexpr (L < MAX_LEVELS)
 	{
-		if (m_displayPoints || m_displaySegments || m_displayGrid)
+		if (L < m_resolution)
 		{
-			value = std::max(value, ComputeColor(x, y, cell1, segments1, points1, cell2, segments2, points2, cell3, segments3, points3, cell4, segments4, points4, cell5, segments5, points5, cell6, segments6, points6));
+			PrefetchControlFunction<L + 1>(topLeft, bottomRight);
 		}
+	}
+}
 
-		if (m_displayDistance)
+/// <summary>
+/// Order in which the pixels of a tile should be evaluated so that pixels
+/// in the same cell at a level are contiguous at this level and all the coarser ones.
+/// </summary>
+/// <param name="levels">Number of levels, the resolution of a level is twice the one of the previous level</param>
+/// <returns>Indices of the pixels in the tile, row by row</returns>
+template <typename I, typename T, typename Display>
+std::vector<int> Noise<I, T, Display>::TileTraversalOrder(const TileRect& rect, int width, int height, int levels) const
+{
+	// Cells of the pixels in all the levels, sorted lexicographically
+	std::vector<std::pair<int, int> > keys(std::size_t(rect.width) * rect.height * levels);
+	for (int i = 0; i < rect.height; i++)
+	{
+		for (int j = 0; j < rect.width; j++)
 		{
-			value = std::max(value, ComputeColorDistance(x, y, cell1, segments1, cell2, segments2, cell3, segments3, cell4, segments4, cell5, segments5, cell6, segments6));
-		}
+			const Point2D pixel = TilePixel(rect.top + i, rect.left + j, width, height);
 
-		return value;
+			std::pair<int, int>* key = &keys[(std::size_t(i) * rect.width + j) * levels];
+			for (int level = 0; level < levels; level++)
+			{
+				const Cell cell = GetCell(pixel.x, pixel.y, 1 << level);
+				key[level] = std::make_pair(cell.y, cell.x);
+			}
+		}
 	}
-	
-	return value;
+
+	std::vector<int> order(std::size_t(rect.width) * rect.height);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&keys, levels](int a, int b) {
+		const auto keyA = keys.begin() + std::size_t(a) * levels;
+		const auto keyB = keys.begin() + std::size_t(b) * levels;
+		return std::lexicographical_compare(keyA, keyA + levels, keyB, keyB + levels);
+	});
+
+	return order;
 }
 
-template <typename I>
-template <typename T, size_t N>
-std::tuple<int, int> Noise<I>::GetArrayCell(const Cell& arrCell, const Array2D<T, N>& arr, const Cell& cell) const
+template <typename I, typename T, typename Display>
+template <typename V, size_t N>
+std::tuple<int, int> Noise<I, T, Display>::GetArrayCell(const Cell& arrCell, const Array2D<V, N>& arr, const Cell& cell) const
 {
 	const int i = (int(arr.size()) / 2) - arrCell.y + cell.y;
 	const int j = (int(arr.front().size()) / 2) - arrCell.x + cell.x;
@@ -1090,37 +2651,66 @@ std::tuple<int, int> Noise<I>::GetArrayCell(const Cell& arrCell, const Array2D<T
 	return std::make_tuple(i, j);
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
+double Noise<I, T, Display>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
 {
 	assert(neighborhood >= 0);
 
-	// Distance to the nearest segment
-	double nearestSegmentDistance = std::numeric_limits<double>::max();
-
 	int ci, cj;
 	std::tie(ci, cj) = GetArrayCell(cell, segments, GetCell(point.x, point.y, cell.resolution));
-	for (int i = ci - neighborhood; i <= ci + neighborhood; i++)
+
+	// Points moved on the border of the domain may be in a cell at the border of the array
+	const int iMin = std::max(ci - neighborhood, 0);
+	const int iMax = std::min(ci + neighborhood, int(N) - 1);
+	const int jMin = std::max(cj - neighborhood, 0);
+	const int jMax = std::min(cj + neighborhood, int(N) - 1);
+
+	// Squared distances to all segments in the rows of the neighborhood, in one pass on the projected segments
+	std::array<T, N * N * D> distSq;
+	const int first = iMin * int(N * D);
+	const int count = (iMax - iMin + 1) * int(N * D);
+	distSqToLineSegments(T(point.x), T(point.y), segments.ax.data() + first, segments.ay.data() + first, segments.bx.data() + first, segments.by.data() + first, count, distSq.data() + first);
+
+	// Squared distance to the nearest segment
+	T nearestSegmentDistSq = std::numeric_limits<T>::infinity();
+	for (int i = iMin; i <= iMax; i++)
 	{
-		for (int j = cj - neighborhood; j <= cj + neighborhood; j++)
+		for (int j = jMin; j <= jMax; j++)
 		{
-			assert(i >= 0 && static_cast<unsigned int>(i) < segments.size());
-			assert(j >= 0 && static_cast<unsigned int>(j) < segments.front().size());
+			for (unsigned int k = 0; k < D; k++)
+			{
+				nearestSegmentDistSq = std::min(nearestSegmentDistSq, distSq[(i * N + j) * D + k]);
+			}
+		}
+	}
+
+	if (!(nearestSegmentDistSq < std::numeric_limits<T>::infinity()))
+	{
+		return std::numeric_limits<double>::max();
+	}
+
+	const T nearestSegmentDistance = std::sqrt(nearestSegmentDistSq);
 
-			for (unsigned int k = 0; k < segments[i][j].size(); k++)
+	// Take the first segment at this distance, squared distances that are almost equal may have the same square root
+	const T tieDistSq = nearestSegmentDistSq * (T(1.0) + T(4.0) * std::numeric_limits<T>::epsilon());
+	for (int i = iMin; i <= iMax; i++)
+	{
+		for (int j = jMin; j <= jMax; j++)
+		{
+			for (unsigned int k = 0; k < D; k++)
 			{
-				Point2D c;
-				const double dist = distToLineSegment(point, ProjectionZ(segments[i][j][k]), c);
+				const T segmentDistSq = distSq[(i * N + j) * D + k];
 
-				if (dist < nearestSegmentDistance)
+				if (segmentDistSq <= tieDistSq && std::sqrt(segmentDistSq) == nearestSegmentDistance)
 				{
-					nearestSegmentDistance = dist;
 					nearestSegmentOut = segments[i][j][k];
 
 					nearestSegmentCellOut.x = i;
 					nearestSegmentCellOut.y = j;
 					nearestSegmentCellOut.resolution = cell.resolution;
+
+					return nearestSegmentDistance;
 				}
 			}
 		}
@@ -1129,15 +2719,15 @@ double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2
 	return nearestSegmentDistance;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D, typename ...Tail>
-double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
+double Noise<I, T, Display>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2D& point, Cell& nearestSegmentCellOut, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
 {
 	assert(neighborhood >= 0);
 
 	// Nearest segment in the sub resolutions
 	Cell nearestSubSegmentCell;
-	Segment3D nearestSubSegment;
+	Segment3DT<T> nearestSubSegment;
 	const double nearestSubSegmentDistance = NearestSegmentAndCellProjectionZ(neighborhood, point, nearestSubSegmentCell, nearestSubSegment, std::forward<Tail>(tail)...);
 
 	// Nearest segment in the current resolution
@@ -1153,25 +2743,25 @@ double Noise<I>::NearestSegmentAndCellProjectionZ(int neighborhood, const Point2
 	return nearestSegmentDistance;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-double Noise<I>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
+double Noise<I, T, Display>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments) const
 {
 	Cell placeholderCell;
 	return NearestSegmentAndCellProjectionZ(neighborhood, point, placeholderCell, nearestSegmentOut, cell, segments);
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D, typename ...Tail>
-double Noise<I>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3D& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
+double Noise<I, T, Display>::NearestSegmentProjectionZ(int neighborhood, const Point2D& point, Segment3DT<T>& nearestSegmentOut, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
 {
 	Cell placeholderCell;
 	return NearestSegmentAndCellProjectionZ(neighborhood, point, placeholderCell, nearestSegmentOut, cell, segments, std::forward<Tail>(tail)...);
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-int Noise<I>::SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentEndingInP) const
+int Noise<I, T, Display>::SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3DT<T>& point, Segment3DT<T>& lastSegmentEndingInP) const
 {
 	int numberSegmentEndingInP = 0;
 
@@ -1200,9 +2790,9 @@ int Noise<I>::SegmentsEndingInP(const Cell& cell, const Segment3DChainArray<N, 1
 	return numberSegmentEndingInP;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-int Noise<I>::SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3D& point, Segment3D& lastSegmentStartingInP) const
+int Noise<I, T, Display>::SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N, 1>& segments, const Point3DT<T>& point, Segment3DT<T>& lastSegmentStartingInP) const
 {
 	int numberStartingInP = 0;
 
@@ -1226,12 +2816,22 @@ int Noise<I>::SegmentsStartingInP(const Cell& cell, const Segment3DChainArray<N,
 	return numberStartingInP;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-typename Noise<I>::template Point2DArray<N> Noise<I>::GenerateNeighboringPoints(const Cell& cell) const
+typename Noise<I, T, Display>::template Point2DArray<N> Noise<I, T, Display>::GenerateNeighboringPoints(const Cell& cell) const
 {
 	Point2DArray<N> points;
 
+	// Random points of the neighboring cells, row by row
+	std::array<Point2D, N * N> cellPoints;
+	m_pointStore->window(cell.x - int(N) / 2, cell.y - int(N) / 2, int(N), int(N), cell.resolution, cellPoints.data());
+	for (Point2D& p : cellPoints)
+	{
+		p /= cell.resolution;
+	}
+
+	const std::array<bool, N * N> insideDomain = InsideDomain(cellPoints);
+
 	// Exploring neighboring cells
 	for (unsigned int i = 0; i < points.size(); i++)
 	{
@@ -1240,10 +2840,10 @@ typename Noise<I>::template Point2DArray<N> Noise<I>::GenerateNeighboringPoints(
 			const int x = cell.x + j - int(points[i].size()) / 2;
 			const int y = cell.y + i - int(points.size()) / 2;
 
-			const Point2D p = GeneratePointCached(x, y) / cell.resolution;
+			const Point2D& p = cellPoints[i * N + j];
 
 			// Bias the random generator to repulse the points outside the domain
-			if (InsideDomain(p))
+			if (insideDomain[i * N + j])
 			{
 				points[i][j] = p;
 			}
@@ -1268,9 +2868,9 @@ typename Noise<I>::template Point2DArray<N> Noise<I>::GenerateNeighboringPoints(
 	return points;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t M>
-void Noise<I>::ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>& points, const Cell& subCell, Point2DArray<N>& subPoints) const
+void Noise<I, T, Display>::ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>& points, const Cell& subCell, Point2DArray<N>& subPoints) const
 {
 	// Ensure that there is enough points around to replace sub-points
 	static_assert(M >= (2 * ((N + 1) / 4) + 1), "Not enough points in the vicinity to replace the sub points.");
@@ -1295,30 +2895,34 @@ void Noise<I>::ReplaceNeighboringPoints(const Cell& cell, const Point2DArray<M>&
 	}
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-typename Noise<I>::template DoubleArray<N> Noise<I>::ComputeElevations(const Point2DArray<N>& points) const
+typename Noise<I, T, Display>::template DoubleArray<N> Noise<I, T, Display>::ComputeElevations(const Point2DArray<N>& points, double footprint) const
 {
-	DoubleArray<N> elevations;
+	std::array<Point2D, N * N> flatPoints;
+	for (unsigned int i = 0; i < N; i++)
+	{
+		std::copy(points[i].begin(), points[i].end(), flatPoints.begin() + i * N);
+	}
 
-	for (unsigned int i = 0; i < elevations.size(); i++)
+	const std::array<double, N * N> values = EvaluateControlFunction(flatPoints, footprint);
+
+	DoubleArray<N> elevations;
+	for (unsigned int i = 0; i < N; i++)
 	{
-		for (unsigned int j = 0; j < elevations[i].size(); j++)
-		{
-			elevations[i][j] = EvaluateControlFunction(points[i][j]);
-		}
+		std::copy(values.begin() + i * N, values.begin() + (i + 1) * N, elevations[i].begin());
 	}
 
 	return elevations;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSegments(const Point2DArray<N>& points) const
+typename Noise<I, T, Display>::template Segment3DChainArray<N - 2 , 1> Noise<I, T, Display>::GenerateSegments(const Point2DArray<N>& points, double footprint) const
 {
 	static_assert(N > 0, "Not enough points");
 
-	const DoubleArray<N> elevations = ComputeElevations<N>(points);
+	const DoubleArray<N> elevations = ComputeElevations<N>(points, footprint);
 
 	Segment3DChainArray<N - 2, 1> segments;
 	for (unsigned int i = 1; i < points.size() - 1; i++)
@@ -1350,13 +2954,13 @@ typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSeg
 			if (InsideDomain(startingPoint) && InsideDomain(endingPoint))
 			{
 				// Both points are in the domain, we keep the segment
-				segments[i - 1][j - 1][0] = Segment3D(startingPoint, endingPoint);
+				segments[i - 1][j - 1] = Segment3DChain<1, T>(Point3DT<T>(startingPoint), {}, Point3DT<T>(endingPoint));
 			}
 			else
 			{
 				// If one of the two points is outside the domain
 				// We discard the segment; it has a null length
-				segments[i - 1][j - 1][0] = Segment3D(startingPoint, startingPoint);
+				segments[i - 1][j - 1] = Segment3DChain<1, T>(Point3DT<T>(startingPoint), {}, Point3DT<T>(startingPoint));
 			}
 		}
 	}
@@ -1364,28 +2968,13 @@ typename Noise<I>::template Segment3DChainArray<N - 2 , 1> Noise<I>::GenerateSeg
 	return segments;
 }
 
-template <typename I>
-template <size_t D>
-void Noise<I>::SegmentChainFromPoints(const Point3D& start, const std::array<Point3D, D - 1>& midPoints, const Point3D& end, Segment3DChain<D>& outSegmentChain) const
-{
-	// First subdivided segment
-	outSegmentChain.front().a = start;
-	for (unsigned int d = 0; d < midPoints.size(); d++)
-	{
-		outSegmentChain[d].b = midPoints[d];
-		outSegmentChain[d + 1].a = midPoints[d];
-	}
-	// Last subdivided segment
-	outSegmentChain.back().b = end;
-}
-
 /// <summary>
 /// Subdivide all segments in a Segment3DArray&lt;N&gt; in D smaller segments using an interpolation spline.
 /// </summary>
 /// Require a Segment3DArray&lt;N&gt; to generate a Segment3DChainArray&lt;N - 2, D&gt; because to subdivide a segment we need its predecessors and successors.
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-void Noise<I>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N, 1>& segments, Segment3DChainArray<N - 2, D>& subdividedSegments) const
+void Noise<I, T, Display>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N, 1>& segments, Segment3DChainArray<N - 2, D>& subdividedSegments) const
 {
 	// Ensure that segments are subdivided.
 	static_assert(N > 0, "Not enough segments");
@@ -1396,19 +2985,19 @@ void Noise<I>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N,
 	{
 		for (unsigned int j = 1; j < segments[i].size() - 1; j++)
 		{
-			Segment3D currentSegment = segments[i][j][0];
+			Segment3DT<T> currentSegment = segments[i][j][0];
 
-			std::array<Point3D, D - 1> midPoints = SubdivideInPoints<D - 1>(currentSegment);
+			std::array<Point3DT<T>, D - 1> midPoints = SubdivideInPoints<D - 1>(currentSegment);
 
 			// If the current segment's length is more than 0, we can subdivide and smooth it
 			if (currentSegment.a != currentSegment.b)
 			{
 				// Segments ending in A
-				Segment3D lastEndingInA;
+				Segment3DT<T> lastEndingInA;
 				const int numberSegmentEndingInA = SegmentsEndingInP(cell, segments, currentSegment.a, lastEndingInA);
 
 				// Segments starting in B
-				Segment3D lastStartingInB;
+				Segment3DT<T> lastStartingInB;
 				const int numberStartingInB = SegmentsStartingInP(cell, segments, currentSegment.b, lastStartingInB);
 
 				if (numberSegmentEndingInA == 1 && numberStartingInB == 1)
@@ -1417,24 +3006,24 @@ void Noise<I>::SubdivideSegments(const Cell& cell, const Segment3DChainArray<N,
 				}
 				else if (numberSegmentEndingInA != 1 && numberStartingInB == 1)
 				{
-					Point3D fakeStartingPoint = 2.0 * currentSegment.a - currentSegment.b;
+					Point3DT<T> fakeStartingPoint = 2.0 * currentSegment.a - currentSegment.b;
 					midPoints = SubdivideCatmullRomSpline<D - 1>(fakeStartingPoint, currentSegment.a, currentSegment.b, lastStartingInB.b);
 				}
 				else if (numberSegmentEndingInA == 1 && numberStartingInB != 1)
 				{
-					Point3D fakeEndingPoint = 2.0 * currentSegment.b - currentSegment.a;
+					Point3DT<T> fakeEndingPoint = 2.0 * currentSegment.b - currentSegment.a;
 					midPoints = SubdivideCatmullRomSpline<D - 1>(lastEndingInA.a, currentSegment.a, currentSegment.b, fakeEndingPoint);
 				}
 			}
 			
-			SegmentChainFromPoints(currentSegment.a, midPoints, currentSegment.b, subdividedSegments[i - 1][j - 1]);
+			subdividedSegments[i - 1][j - 1] = Segment3DChain<D, T>(currentSegment.a, midPoints, currentSegment.b);
 		}
 	}
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-void Noise<I>::DisplaceSegments(double displacementFactor, const Cell& cell, Segment3DChainArray<N, D>& segments) const
+void Noise<I, T, Display>::DisplaceSegments(double displacementFactor, const Cell& cell, Segment3DChainArray<N, D>& segments) const
 {
 	// Ensure that segments are subdivided.
 	static_assert(D > 1, "Segments should be subdivided in more than 1 part.");
@@ -1445,51 +3034,51 @@ void Noise<I>::DisplaceSegments(double displacementFactor, const Cell& cell, Seg
 		for (unsigned int j = 0; j < segments[i].size(); j++)
 		{
 			// First point of the segment chain
-			const Point2D a = ProjectionZ(segments[i][j].front().a);
+			const Point2DT<T> a = ProjectionZ(segments[i][j].points.front());
 			// Last point of the segment chain
-			const Point2D b = ProjectionZ(segments[i][j].back().b);
+			const Point2DT<T> b = ProjectionZ(segments[i][j].points.back());
 
-			const Vec2D ab(a, b);
-			const Vec3D displacementVector(rotateCCW90(ab), 0.0);
+			const Vec2DT<T> ab(a, b);
+			const Vec3DT<T> displacementVector(rotateCCW90(ab), 0.0);
 
 			// Generate random numbers according to the position of the first point of the segment chain
-			Cell aCell = GetCell(a.x, a.y, cell.resolution);
-			RandomGenerator generator = InitRandomGenerator(aCell.x, aCell.y);
-			std::uniform_real_distribution<double> distribution(-displacementFactor, displacementFactor);
+			const Cell aCell = GetCell(a.x, a.y, cell.resolution);
+			const std::array<double, D - 1> factors = GenerateDisplacementFactors<D - 1>(displacementFactor, aCell);
 
 			for (unsigned int k = 0; k < segments[i][j].size() - 1; k++)
 			{
-				const double factor = distribution(generator);
-				segments[i][j][k].b += factor * displacementVector;
-				segments[i][j][k + 1].a += factor * displacementVector;
+				segments[i][j].points[k + 1] += factors[k] * displacementVector;
 			}
 		}
 	}
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N2, size_t N1, size_t D1>
-void Noise<I>::CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments) const
+void Noise<I, T, Display>::CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments) const
 {
 	// Ensure that there is enough segments around to connect sub points
 	static_assert(N1 >= (2 * ((N2 + 1) / 4) + 3), "Not enough segments in the vicinity to connect sub points.");
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N2, size_t N1, size_t D1, typename ...Tail>
-void Noise<I>::CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, Tail&&... tail) const
+void Noise<I, T, Display>::CheckEnoughSegmentInVicinity(const Point2DArray<N2>& points, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, Tail&&... tail) const
 {
 	CheckEnoughSegmentInVicinity(points, cell, segments);
 	CheckEnoughSegmentInVicinity(points, std::forward<Tail>(tail)...);
 }
 
-template <typename I>
-template <size_t N, size_t D, typename ...Tail>
-typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegments(const ConnectionStrategy& connectionStrategy, double minSlope, const Point2DArray<N>& points, Tail&&... tail) const
+template <typename I, typename T, typename Display>
+template <typename Noise<I, T, Display>::ConnectionStrategy S, size_t N, size_t D, typename ...Tail>
+typename Noise<I, T, Display>::template Segment3DChainArray<N , D> Noise<I, T, Display>::GenerateSubSegments(double minSlope, double footprint, const Point2DArray<N>& points, Tail&&... tail) const
 {
 	// Ensure that there is enough segments around to connect sub points
 	CheckEnoughSegmentInVicinity(points, std::forward<Tail>(tail)...);
 
+	// Elevation of the points on the control function
+	const DoubleArray<N> elevationsControlFunction = ComputeElevations(points, footprint);
+
 	// Connect each point to the nearest segment
 	Segment3DChainArray<N, D> subSegments;
 	for (unsigned int i = 0; i < points.size(); i++)
@@ -1500,25 +3089,25 @@ typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegm
 			const Point2D point = points[i][j];
 
 			// Find the nearest segment
-			Segment3D nearestSegment;
+			Segment3DT<T> nearestSegment;
 			double nearestSegmentDist = NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
 
-			const double u = pointLineSegmentProjection(point, ProjectionZ(nearestSegment));
-			const Point3D nearestPointOnSegment = lerp(nearestSegment, u);
+			const T u = pointLineSegmentProjection(Point2DT<T>(point), ProjectionZ(nearestSegment));
+			const Point3DT<T> nearestPointOnSegment = lerp(nearestSegment, u);
 
 			// Compute elevation of the point on the control function
-			const double elevationControlFunction = EvaluateControlFunction(point);
+			const double elevationControlFunction = elevationsControlFunction[i][j];
 			// Compute elevation with a constraint on slope
 			// Warning, the actual slope may change if the connection point is changed in ConnectPointToSegment
 			const double elevationWithMinSlope = nearestPointOnSegment.z + minSlope * nearestSegmentDist;
 
 			const double elevation = std::max(elevationWithMinSlope, elevationControlFunction);
 
-			const Point3D p(point.x, point.y, elevation);
+			const Point3DT<T> p(point.x, point.y, elevation);
 
-			const Segment3DChain<D> segmentChain = ConnectPointToSegment<D>(connectionStrategy, p, nearestSegmentDist, nearestSegment);
+			const Segment3DChain<D, T> segmentChain = ConnectPointToSegment<S, D>(p, nearestSegmentDist, nearestSegment);
 
-			if (length_sq(nearestSegment) > 0.0 && InsideDomain(segmentChain.front().a) && InsideDomain(segmentChain.back().b))
+			if (length_sq(nearestSegment) > 0.0 && InsideDomain(segmentChain.points.front()) && InsideDomain(segmentChain.points.back()))
 			{
 				subSegments[i][j] = segmentChain;
 			}
@@ -1526,7 +3115,7 @@ typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegm
 			{
 				// Warning, in some cases, even if length_sq(nearestSegment) == 0.0, we would want to connect the point to the segment
 				// It happens we a point is generated exactly on a segment. The segment starting from this point has a null length.
-				subSegments[i][j] = SubdivideInSegments<D>(Segment3D(p, p));
+				subSegments[i][j] = SubdivideInSegments<D>(Segment3DT<T>(p, p));
 			}
 		}
 	}
@@ -1534,9 +3123,9 @@ typename Noise<I>::template Segment3DChainArray<N , D> Noise<I>::GenerateSubSegm
 	return subSegments;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N>
-double Noise<I>::ComputeColorPoints(double x, double y, const Point2DArray<N>& points, double radius) const
+double Noise<I, T, Display>::ComputeColorPoints(double x, double y, const Point2DArray<N>& points, double radius) const
 {
 	double value = 0.0;
 
@@ -1554,9 +3143,9 @@ double Noise<I>::ComputeColorPoints(double x, double y, const Point2DArray<N>& p
 	return value;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-double Noise<I>::ComputeColorPoints(double x, double y, const Segment3DChainArray<N, D>& segments, double radius) const
+double Noise<I, T, Display>::ComputeColorPoints(double x, double y, const Segment3DChainArray<N, D>& segments, double radius) const
 {
 	double value = 0.0;
 
@@ -1565,10 +3154,9 @@ double Noise<I>::ComputeColorPoints(double x, double y, const Segment3DChainArra
 	{
 		for (unsigned int j = 0; j < segments[i].size(); j++)
 		{
-			for (unsigned int k = 0; k < segments[i][j].size(); k++)
+			for (const Point3DT<T>& point : segments[i][j].points)
 			{
-				value = std::max(value, ComputeColorPoint(x, y, ProjectionZ(segments[i][j][k].a), radius));
-				value = std::max(value, ComputeColorPoint(x, y, ProjectionZ(segments[i][j][k].b), radius));
+				value = std::max(value, ComputeColorPoint(x, y, Point2D(ProjectionZ(point)), radius));
 			}
 		}
 	}
@@ -1576,14 +3164,14 @@ double Noise<I>::ComputeColorPoints(double x, double y, const Segment3DChainArra
 	return value;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N, size_t D>
-double Noise<I>::ComputeColorSegments(const Cell& cell, const Segment3DChainArray<N, D>& segments, int neighborhood, double x, double y, double radius) const
+double Noise<I, T, Display>::ComputeColorSegments(const Cell& cell, const Segment3DChainArray<N, D>& segments, int neighborhood, double x, double y, double radius) const
 {
 	double value = 0.0;
 
 	// White when near to a segment
-	Segment3D nearestSegment;
+	Segment3DT<T> nearestSegment;
 	const double nearestSegmentDistance = NearestSegmentProjectionZ(neighborhood, Point2D(x, y), nearestSegment, cell, segments);
 	
 	/*
@@ -1606,26 +3194,43 @@ double Noise<I>::ComputeColorSegments(const Cell& cell, const Segment3DChainArra
 	return value;
 }
 
-template <typename I>
+/// <summary>
+/// Segments of all the levels, as displayed by ComputeColor when only the segments are displayed
+/// </summary>
+template <typename I, typename T, typename Display>
+template <size_t N, size_t D, typename ...Tail>
+double Noise<I, T, Display>::ComputeColorSegmentsMask(double x, double y, const Cell& cell, const Segment3DChainArray<N, D>& segments, Tail&&... tail) const
+{
+	double value = ComputeColorSegments(cell, segments, 2, x, y, DisplayRadius(cell) / 4.0);
+
+	if constexpr (sizeof...(Tail) > 0)
+	{
+		value = std::max(value, ComputeColorSegmentsMask(x, y, std::forward<Tail>(tail)...));
+	}
+
+	return value;
+}
+
+template <typename I, typename T, typename Display>
 template <size_t N1, size_t D1, size_t N2>
-double Noise<I>::ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points) const
+double Noise<I, T, Display>::ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points) const
 {
 	double value = 0.0;
 
-	const double radius = 1.0 / (26 * std::exp(0.085 * cell.resolution));
+	const double radius = DisplayRadius(cell);
 
-	if (m_displayPoints)
+	if (m_display.points())
 	{
 		value = std::max(value, ComputeColorPoints(x, y, points, radius));
 		value = std::max(value, ComputeColorPoints(x, y, segments, radius / 2.0));
 	}
 
-	if (m_displaySegments)
+	if (m_display.segments())
 	{
 		value = std::max(value, ComputeColorSegments(cell, segments, 2, x, y, radius / 4.0));
 	}
 
-	if (m_displayGrid)
+	if (m_display.grid())
 	{
 		for (int i = 0; i <= cell.resolution; i++)
 		{
@@ -1637,9 +3242,9 @@ double Noise<I>::ComputeColor(double x, double y, const Cell& cell, const Segmen
 	return value;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <size_t N1, size_t D1, size_t N2, typename ...Tail>
-double Noise<I>::ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points, Tail&&... tail) const
+double Noise<I, T, Display>::ComputeColor(double x, double y, const Cell& cell, const Segment3DChainArray<N1, D1>& segments, const Point2DArray<N2>& points, Tail&&... tail) const
 {
 	const double valueCurrentLevel = ComputeColor(x, y, cell, segments, points);
 	const double valueTail = ComputeColor(x, y, std::forward<Tail>(tail)...);
@@ -1647,11 +3252,22 @@ double Noise<I>::ComputeColor(double x, double y, const Cell& cell, const Segmen
 	return std::max(valueCurrentLevel, valueTail);
 }
 
-template <typename I>
+/// <summary>
+/// Build the primitives centered on the highest resolution points around (x, y).
+/// The nearest segment of each primitive is only searched when (x, y) moves to another highest resolution cell.
+/// </summary>
+/// <param name="higherResCell">Cell of the last level containing (x, y)</param>
+/// <param name="higherResPoints">Points of the last level around higherResCell</param>
+/// <param name="lattice">The primitives built for the previous point, updated for (x, y)</param>
+template <typename I, typename T, typename Display>
 template <size_t N, typename ...Tail>
-double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, Tail&&... tail) const
+void Noise<I, T, Display>::BuildPrimitives(double x, double y, const Cell& higherResCell, const Point2DArray<N>& higherResPoints, PrimitiveLattice<N>& lattice, Tail&&... tail) const
 {
-	const Point2D point(x, y);
+	// The highest resolution cell contains the point (x, y) at all the coarser levels
+	if (lattice.cell == GetCell(x, y, higherResCell.resolution << m_primitivesResolutionSteps))
+	{
+		return;
+	}
 
 	// Generate higher resolution points, which are going to be the centers of primitives
 	Cell highestResCell = higherResCell;
@@ -1666,54 +3282,70 @@ double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherRe
 		highestResPoints = newPoints;
 	}
 
-	// Radius of primitives
-	const double R = 2.0 / highestResCell.resolution;
-	// Power to the Wyvill-Galin function
-	const double P = 3.0;
-
-	// Numerator and denominator used to compute the blend of primitives
-	double numerator = 0.0;
-	double denominator = 0.0;
-
+	lattice.cell = highestResCell;
 	for (unsigned int i = 0; i < highestResPoints.size(); i++)
 	{
 		for (unsigned int j = 0; j < highestResPoints[i].size(); j++)
 		{
 			// Nearest segment to points[i][j] and nearest point on this segment
 			Cell primitiveNearestSegmentCell;
-			Segment3D primitiveNearestSegment;
+			Segment3DT<T> primitiveNearestSegment;
 			const double distancePrimitiveCenter = NearestSegmentAndCellProjectionZ(1, highestResPoints[i][j], primitiveNearestSegmentCell, primitiveNearestSegment, std::forward<Tail>(tail)...);
-			double uPrimitive = pointLineSegmentProjection(highestResPoints[i][j], ProjectionZ(primitiveNearestSegment));
-
-			double distancePrimitive = dist(point, highestResPoints[i][j]);
+			T uPrimitive = pointLineSegmentProjection(Point2DT<T>(highestResPoints[i][j]), ProjectionZ(primitiveNearestSegment));
 
-			const double alphaPrimitive = WyvillGalinFunction(distancePrimitive, R, P);
-			const double nearestPointOnSegmentHeight = lerp(primitiveNearestSegment.a.z, primitiveNearestSegment.b.z, uPrimitive);
+			const T nearestPointOnSegmentHeight = lerp(primitiveNearestSegment.a.z, primitiveNearestSegment.b.z, uPrimitive);
 
 			// Adaptive slope depending on the mountain height
-			const double controlFunctionMinimum = ControlFunctionMinimum();
-			const double controlFunctionMaximum = ControlFunctionMaximum();
-			const double adaptiveSlope = smootherstep(controlFunctionMinimum, controlFunctionMaximum, pow(nearestPointOnSegmentHeight, m_slopePower));
-
-			// Noise
-			const double amplitudeMax = m_noiseAmplitudeProportion * (controlFunctionMaximum - controlFunctionMinimum) / higherResCell.resolution;
-			const double periodPerCell = 4.0;
-			const double terrainSizeX = m_noiseBottomRight.x - m_noiseTopLeft.x;
-			const double terrainSizeY = m_noiseBottomRight.y - m_noiseTopLeft.y;
-			const double higherResCellSize = std::max(terrainSizeX, terrainSizeY) / higherResCell.resolution;
-			const double highestResCellSizeX = terrainSizeX / highestResCell.resolution;
-			const double highestResCellSizeY = terrainSizeY / highestResCell.resolution;
-			const double amplitude = amplitudeMax * smootherstep(0.0, higherResCellSize / 4.0, distancePrimitiveCenter);
-			const double wavelengthX = highestResCellSizeX / periodPerCell;
-			const double wavelengthY = highestResCellSizeY / periodPerCell;
-			const double noise = amplitude * Perlin(x / wavelengthX, y / wavelengthY)
-							   + 0.5 * amplitude * Perlin(x / (2.0 * wavelengthX), y / (2.0 * wavelengthY))
-							   + 0.25 * amplitude * Perlin(x / (4.0 * wavelengthX), y / (4.0 * wavelengthY));
+			const double adaptiveSlope = smootherstep(m_context.controlFunctionMinimum, m_context.controlFunctionMaximum, pow(nearestPointOnSegmentHeight, m_slopePower));
+
+			Primitive& primitive = lattice.primitives[i][j];
+			primitive.center = highestResPoints[i][j];
+			primitive.elevation = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter;
+			primitive.amplitude = m_context.amplitudeMax * smootherstep(0.0, m_context.amplitudeDistance, distancePrimitiveCenter);
+		}
+	}
+}
+
+/// <summary>
+/// Blend the primitives around (x, y) with the Wyvill-Galin function
+/// </summary>
+/// <param name="lattice">Primitives built by BuildPrimitives for (x, y)</param>
+template <typename I, typename T, typename Display>
+template <size_t N>
+double Noise<I, T, Display>::ComputeColorPrimitives(double x, double y, const PrimitiveLattice<N>& lattice) const
+{
+	const Point2D point(x, y);
+
+	// Radius of primitives
+	const T R = T(m_context.primitiveRadius);
+	// Power to the Wyvill-Galin function
+	const T P = 3.0;
+
+	// Noise, its amplitude depends on the primitive. Three octaves with wavelengths
+	// multiplied by 1, 2 and 4 and weights 1, 0.5 and 0.25
+	const double perlin = PerlinFBm(x / m_context.wavelengthX, y / m_context.wavelengthY, 3, 0.5, 0.5);
+
+	// Numerator and denominator used to compute the blend of primitives
+	T numerator = 0.0;
+	T denominator = 0.0;
+
+	for (unsigned int i = 0; i < lattice.primitives.size(); i++)
+	{
+		for (unsigned int j = 0; j < lattice.primitives[i].size(); j++)
+		{
+			const Primitive& primitive = lattice.primitives[i][j];
+
+			T distancePrimitive = dist(point, primitive.center);
+
+			const T alphaPrimitive = WyvillGalinFunction(distancePrimitive, R, P);
+
+			const double amplitude = primitive.amplitude;
+			const double noise = amplitude * perlin;
 
 			// Final elevation
-			const double elevation = nearestPointOnSegmentHeight + adaptiveSlope * distancePrimitiveCenter + noise;
+			const double elevation = primitive.elevation + noise;
 
-			numerator += alphaPrimitive * elevation;
+			numerator += alphaPrimitive * T(elevation);
 			denominator += alphaPrimitive;
 		}
 	}
@@ -1724,21 +3356,100 @@ double Noise<I>::ComputeColorPrimitives(double x, double y, const Cell& higherRe
 	return numerator / denominator;
 }
 
-template <typename I>
+/// <summary>
+/// Blend the primitives around (x, y) like ComputeColorPrimitives, and compute the gradient of the blend
+/// </summary>
+/// <param name="lattice">Primitives built by BuildPrimitives for (x, y)</param>
+/// <param name="dx">Partial derivative of the blend along x</param>
+/// <param name="dy">Partial derivative of the blend along y</param>
+template <typename I, typename T, typename Display>
+template <size_t N>
+double Noise<I, T, Display>::ComputeColorPrimitivesWithGradient(double x, double y, const PrimitiveLattice<N>& lattice, double& dx, double& dy) const
+{
+	const Point2D point(x, y);
+
+	// Radius of primitives
+	const T R = T(m_context.primitiveRadius);
+	// Power to the Wyvill-Galin function
+	const T P = 3.0;
+
+	// Noise and its gradient in the coordinates of the noise
+	double perlinDx, perlinDy;
+	const double perlin = PerlinFBm(x / m_context.wavelengthX, y / m_context.wavelengthY, 3, 0.5, 0.5, perlinDx, perlinDy);
+	perlinDx /= m_context.wavelengthX;
+	perlinDy /= m_context.wavelengthY;
+
+	// Numerator and denominator used to compute the blend of primitives, and their gradients
+	T numerator = 0.0;
+	T denominator = 0.0;
+	double numeratorDx = 0.0;
+	double numeratorDy = 0.0;
+	double denominatorDx = 0.0;
+	double denominatorDy = 0.0;
+
+	for (unsigned int i = 0; i < lattice.primitives.size(); i++)
+	{
+		for (unsigned int j = 0; j < lattice.primitives[i].size(); j++)
+		{
+			const Primitive& primitive = lattice.primitives[i][j];
+
+			T distancePrimitive = dist(point, primitive.center);
+
+			T alphaDerivative;
+			const T alphaPrimitive = WyvillGalinFunction(distancePrimitive, R, P, alphaDerivative);
+
+			const double amplitude = primitive.amplitude;
+			const double noise = amplitude * perlin;
+
+			// Final elevation
+			const double elevation = primitive.elevation + noise;
+
+			numerator += alphaPrimitive * T(elevation);
+			denominator += alphaPrimitive;
+
+			// The distance to the center has a gradient of norm 1, directed away from the center
+			double alphaDx = 0.0;
+			double alphaDy = 0.0;
+			if (distancePrimitive > 0.0)
+			{
+				alphaDx = alphaDerivative * (x - primitive.center.x) / distancePrimitive;
+				alphaDy = alphaDerivative * (y - primitive.center.y) / distancePrimitive;
+			}
+
+			numeratorDx += alphaDx * elevation + alphaPrimitive * amplitude * perlinDx;
+			numeratorDy += alphaDy * elevation + alphaPrimitive * amplitude * perlinDy;
+			denominatorDx += alphaDx;
+			denominatorDy += alphaDy;
+		}
+	}
+
+	// denominator shouldn't be equal to zero if there is enough primitives around the point.
+	assert(denominator != 0.0);
+
+	const double value = numerator / denominator;
+
+	// Quotient rule
+	dx = (numeratorDx - value * denominatorDx) / denominator;
+	dy = (numeratorDy - value * denominatorDy) / denominator;
+
+	return value;
+}
+
+template <typename I, typename T, typename Display>
 template <typename ...Tail>
-double Noise<I>::ComputeColorControlFunction(double x, double y, Tail&&... tail) const
+double Noise<I, T, Display>::ComputeColorControlFunction(double x, double y, Tail&&... tail) const
 {
 	const Point2D point(x, y);
 
 	// nearest segment
-	Segment3D nearestSegment;
+	Segment3DT<T> nearestSegment;
 	const double d = NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
 
 	double value;
 
 	if (d < (1.0 / 32.0))
 	{
-		const double u = pointLineSegmentProjection(point, ProjectionZ(nearestSegment));
+		const T u = pointLineSegmentProjection(Point2DT<T>(point), ProjectionZ(nearestSegment));
 		// Elevation of the nearest point
 		value = lerp(nearestSegment.a.z, nearestSegment.b.z, u);
 	}
@@ -1750,15 +3461,43 @@ double Noise<I>::ComputeColorControlFunction(double x, double y, Tail&&... tail)
 	return value;
 }
 
-template <typename I>
+template <typename I, typename T, typename Display>
 template <typename ... Tail>
-double Noise<I>::ComputeColorDistance(double x, double y, Tail&&... tail) const
+double Noise<I, T, Display>::ComputeColorDistance(double x, double y, Tail&&... tail) const
 {
 	const Point2D point(x, y);
 
 	// nearest segment
-	Segment3D nearestSegment;
+	Segment3DT<T> nearestSegment;
 	return NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
 }
 
+/// <summary>
+/// Distance to the nearest segment, like ComputeColorDistance, and its gradient
+/// </summary>
+template <typename I, typename T, typename Display>
+template <typename ... Tail>
+double Noise<I, T, Display>::ComputeColorDistanceWithGradient(double x, double y, double& dx, double& dy, Tail&&... tail) const
+{
+	const Point2D point(x, y);
+
+	// nearest segment
+	Segment3DT<T> nearestSegment;
+	const double distance = NearestSegmentProjectionZ(1, point, nearestSegment, std::forward<Tail>(tail)...);
+
+	// The gradient is the unit vector from the nearest point of the segment to the point
+	Point2DT<T> nearestPoint;
+	distToLineSegment(Point2DT<T>(point), ProjectionZ(nearestSegment), nearestPoint);
+
+	dx = 0.0;
+	dy = 0.0;
+	if (distance > 0.0)
+	{
+		dx = (x - double(nearestPoint.x)) / distance;
+		dy = (y - double(nearestPoint.y)) / distance;
+	}
+
+	return distance;
+}
+
 #endif // NOISE_H
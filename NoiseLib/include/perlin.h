@@ -1,6 +1,30 @@
 #ifndef PERLIN_H
 #define PERLIN_H
 
+#include <cstddef>
+
 double Perlin(double x, double y);
 
-#endif // PERLIN_H
\ No newline at end of file
+// Compute Perlin noise at the n points (x[k], y[k]), with AVX2 when the processor supports it.
+// The values are identical to the ones of Perlin(x[k], y[k]).
+void Perlin(const double* x, const double* y, double* out, size_t n);
+
+// Compute Perlin noise at coordinates x, y and its partial derivatives dx, dy
+double Perlin(double x, double y, double& dx, double& dy);
+
+// Compute Perlin noise and its partial derivatives at the n points (x[k], y[k]), with AVX2 when the
+// processor supports it. The values are identical to the ones of Perlin(x[k], y[k], dx[k], dy[k]).
+void Perlin(const double* x, const double* y, double* out, double* dx, double* dy, size_t n);
+
+// Maximum number of octaves of PerlinFBm
+const int FBM_MAX_OCTAVES = 16;
+
+// Sum of octaves of Perlin noise, the octave k is evaluated at (x, y) * lacunarity^k
+// and weighted by gain^k. All the octaves are evaluated in one batch. The octaves fall in
+// different cells, so they share no cell or hash computation, only the vectors of the batch.
+double PerlinFBm(double x, double y, int octaves, double lacunarity, double gain);
+
+// Same sum of octaves, with its partial derivatives dx, dy, evaluated in one batch with derivatives
+double PerlinFBm(double x, double y, int octaves, double lacunarity, double gain, double& dx, double& dy);
+
+#endif // PERLIN_H
@@ -1,6 +1,8 @@
 #ifndef PERLINCONTROLFUNCTION_H
 #define PERLINCONTROLFUNCTION_H
 
+#include <algorithm>
+
 #include "controlfunction.h"
 
 #include "perlin.h"
@@ -23,6 +25,21 @@ protected:
 		return true;
 	}
 
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+	{
+		Perlin(x, y, values, size_t(n));
+
+		for (int k = 0; k < n; k++)
+		{
+			values[k] = m_scale * (values[k] + 1.0) / 2.0;
+		}
+	}
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		std::fill(inside, inside + n, true);
+	}
+
 	double DistToDomainImpl(double x, double y) const
 	{
 		return 0.0;
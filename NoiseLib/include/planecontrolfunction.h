@@ -1,7 +1,11 @@
 #ifndef PLANECONTROLFUNCTION_H
 #define PLANECONTROLFUNCTION_H
 
+#include <algorithm>
+#include <array>
+
 #include "controlfunction.h"
+#include "perlin.h"
 
 class PlaneControlFunction : public ControlFunction<PlaneControlFunction>
 {
@@ -18,6 +22,36 @@ protected:
 		return true;
 	}
 
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+	{
+		// The points are scaled by blocks to stay on the stack
+		const int BLOCK_SIZE = 64;
+		std::array<double, BLOCK_SIZE> scaledX;
+		std::array<double, BLOCK_SIZE> scaledY;
+
+		for (int first = 0; first < n; first += BLOCK_SIZE)
+		{
+			const int count = std::min(BLOCK_SIZE, n - first);
+			for (int k = 0; k < count; k++)
+			{
+				scaledX[k] = 4.0 * x[first + k];
+				scaledY[k] = 4.0 * y[first + k];
+			}
+
+			Perlin(scaledX.data(), scaledY.data(), values + first, size_t(count));
+		}
+
+		for (int k = 0; k < n; k++)
+		{
+			values[k] = x[k] / 8.0 + (values[k] + 1.0) / 8.0;
+		}
+	}
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		std::fill(inside, inside + n, true);
+	}
+
 	double DistToDomainImpl(double x, double y) const
 	{
 		return 0.0;
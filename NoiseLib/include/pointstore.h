@@ -0,0 +1,88 @@
+#ifndef POINTSTORE_H
+#define POINTSTORE_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "math2d.h"
+#include "randomgenerator.h"
+
+/// <summary>
+/// Lazily filled store of the random points generated in cells.
+/// Points are generated by blocks of BLOCK_SIZE x BLOCK_SIZE cells the first time
+/// one of them is accessed, and kept until the store is destroyed.
+/// The store is thread-safe and can be shared by all the noises with the same
+/// seed, epsilon and random generator.
+/// </summary>
+class PointStore
+{
+public:
+	static const int BLOCK_SIZE = 32;
+
+	PointStore(int seed, double eps, RandomGeneratorType randomGeneratorType);
+
+	/// <summary>
+	/// Return the store shared by all noises with these parameters.
+	/// The store is created if no other noise currently uses it.
+	/// </summary>
+	static std::shared_ptr<PointStore> shared(int seed, double eps, RandomGeneratorType randomGeneratorType);
+
+	int seed() const { return m_seed; }
+	double eps() const { return m_eps; }
+	RandomGeneratorType randomGeneratorType() const { return m_randomGeneratorType; }
+
+	/// <summary>
+	/// Generate a point in a cell without using the store.
+	/// This function is reproducible.
+	/// </summary>
+	/// <param name="x">x coordinate of the cell</param>
+	/// <param name="y">y coordinate of the cell</param>
+	/// <param name="resolution">Resolution of the cell, ignored by the legacy generator</param>
+	/// <returns>A Point2D in this cell</returns>
+	Point2D generatePoint(int x, int y, int resolution) const;
+
+	/// <summary>
+	/// Copy the points of a window of cells
+	/// </summary>
+	/// <param name="x">x coordinate of the top left cell of the window</param>
+	/// <param name="y">y coordinate of the top left cell of the window</param>
+	/// <param name="width">Number of cells in a row of the window</param>
+	/// <param name="height">Number of rows of the window</param>
+	/// <param name="resolution">Resolution of the cells</param>
+	/// <param name="out">Points of the window, row by row</param>
+	void window(int x, int y, int width, int height, int resolution, Point2D* out) const;
+
+private:
+	typedef std::array<Point2D, BLOCK_SIZE * BLOCK_SIZE> Block;
+
+	struct BlockKey
+	{
+		int level;
+		int x;
+		int y;
+
+		bool operator==(const BlockKey& other) const { return level == other.level && x == other.x && y == other.y; }
+	};
+
+	struct BlockKeyHash
+	{
+		size_t operator()(const BlockKey& key) const;
+	};
+
+	const Block& GetBlock(const BlockKey& key) const;
+
+	std::unique_ptr<Block> GenerateBlock(const BlockKey& key) const;
+
+	const int m_seed;
+	const double m_eps;
+	const RandomGeneratorType m_randomGeneratorType;
+
+	// Blocks are never removed, so references to them stay valid
+	mutable std::shared_mutex m_mutex;
+	mutable std::unordered_map<BlockKey, std::unique_ptr<Block>, BlockKeyHash> m_blocks;
+};
+
+#endif // POINTSTORE_H
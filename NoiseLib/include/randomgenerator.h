@@ -0,0 +1,98 @@
+#ifndef RANDOMGENERATOR_H
+#define RANDOMGENERATOR_H
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/// <summary>
+/// Random generator used to place points and displace segments in cells
+/// </summary>
+enum class RandomGeneratorType
+{
+	// std::mt19937_64 seeded for each cell, used to generate the figures of the paper
+	MersenneTwister,
+	// Stateless counter-based generator, independent of the standard library
+	CounterBased
+};
+
+// Streams of the counter-based random generator
+const int POINT_STREAM = 0;
+const int DISPLACEMENT_STREAM = 1;
+
+/// <summary>
+/// Create the legacy random generator of a cell
+/// </summary>
+/// <param name="seed">Seed of the noise</param>
+/// <param name="i">x coordinate of the cell</param>
+/// <param name="j">y coordinate of the cell</param>
+inline std::mt19937_64 InitLegacyRandomGenerator(int seed, int i, int j)
+{
+	// TODO: implement a better permutation method
+	const int cellSeed = (541 * i + 79 * j + seed) % std::numeric_limits<int>::max();
+	// Fixed seed for internal consistency
+	return std::mt19937_64(cellSeed);
+}
+
+/// <summary>
+/// Mix the bits of a 64 bits integer (SplitMix64 finalizer).
+/// This function is a bijection.
+/// </summary>
+inline uint64_t MixBits(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/// <summary>
+/// Counter-based random generator.
+/// The n-th number of a stream is a hash of its key and n, so a stream can be
+/// created for any (seed, level, cell, stream) without initializing a state.
+/// </summary>
+class CounterRandomGenerator
+{
+public:
+	/// <summary>
+	/// Create the stream of random numbers of a cell
+	/// </summary>
+	/// <param name="seed">Seed of the noise</param>
+	/// <param name="level">Level of the cell, for example its resolution</param>
+	/// <param name="x">x coordinate of the cell</param>
+	/// <param name="y">y coordinate of the cell</param>
+	/// <param name="stream">Index of the stream, to draw independent numbers in the same cell</param>
+	CounterRandomGenerator(int seed, int level, int x, int y, int stream) : m_counter(0)
+	{
+		// Both packings are injective, and MixBits is a bijection:
+		// two cells with the same seed, level and stream never share their key
+		const uint64_t parameters = (uint64_t(uint32_t(seed)) << 32) | (uint64_t(uint16_t(level)) << 16) | uint64_t(uint16_t(stream));
+		const uint64_t cell = (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+
+		m_key = MixBits(cell ^ MixBits(parameters));
+	}
+
+	/// <summary>
+	/// Return the next 64 random bits of the stream
+	/// </summary>
+	uint64_t operator()()
+	{
+		m_counter++;
+		return MixBits(m_key + m_counter * 0x9e3779b97f4a7c15ULL);
+	}
+
+	/// <summary>
+	/// Return the next random number of the stream, uniformly distributed in [a, b[
+	/// </summary>
+	double uniform(double a, double b)
+	{
+		// The 53 most significant bits give a double uniformly distributed in [0, 1[
+		const double u = double((*this)() >> 11) * (1.0 / 9007199254740992.0);
+		return a + (b - a) * u;
+	}
+
+private:
+	uint64_t m_key;
+	uint64_t m_counter;
+};
+
+#endif // RANDOMGENERATOR_H
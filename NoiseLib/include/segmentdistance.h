@@ -0,0 +1,24 @@
+#ifndef SEGMENTDISTANCE_H
+#define SEGMENTDISTANCE_H
+
+/// <summary>
+/// Compute the squared distances from a point to a list of segments stored as a structure of arrays.
+/// Each distance is bit-identical to the square of distToLineSegment(p, a, b, c).
+/// Use AVX or SSE2 instructions when they are supported by the processor.
+/// </summary>
+/// <param name="px">x coordinate of the point</param>
+/// <param name="py">y coordinate of the point</param>
+/// <param name="ax">x coordinates of the first points of the segments</param>
+/// <param name="ay">y coordinates of the first points of the segments</param>
+/// <param name="bx">x coordinates of the second points of the segments</param>
+/// <param name="by">y coordinates of the second points of the segments</param>
+/// <param name="count">Number of segments</param>
+/// <param name="out">Squared distances to the segments</param>
+void distSqToLineSegments(double px, double py, const double* ax, const double* ay, const double* bx, const double* by, int count, double* out);
+
+/// <summary>
+/// Single precision version of distSqToLineSegments, processing twice as many segments per instruction.
+/// </summary>
+void distSqToLineSegments(float px, float py, const float* ax, const float* ay, const float* bx, const float* by, int count, float* out);
+
+#endif // SEGMENTDISTANCE_H
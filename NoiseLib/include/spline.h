@@ -6,23 +6,27 @@
 
 // Chordal Catmull-Rom spline
 // t is an absolute time
-Point2D CatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, double t);
-Point3D CatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3, double t);
+template <typename T>
+Point2DT<T> CatmullRomSpline(const Point2DT<T>& p0, const Point2DT<T>& p1, const Point2DT<T>& p2, const Point2DT<T>& p3, typename Point2DT<T>::Scalar t);
+template <typename T>
+Point3DT<T> CatmullRomSpline(const Point3DT<T>& p0, const Point3DT<T>& p1, const Point3DT<T>& p2, const Point3DT<T>& p3, typename Point3DT<T>::Scalar t);
 
 // Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline
 // x is the proportion of time between t1 and t2
-Point2D SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, double x);
-Point3D SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3, double x);
+template <typename T>
+Point2DT<T> SubdivideCatmullRomSpline(const Point2DT<T>& p0, const Point2DT<T>& p1, const Point2DT<T>& p2, const Point2DT<T>& p3, typename Point2DT<T>::Scalar x);
+template <typename T>
+Point3DT<T> SubdivideCatmullRomSpline(const Point3DT<T>& p0, const Point3DT<T>& p1, const Point3DT<T>& p2, const Point3DT<T>& p3, typename Point3DT<T>::Scalar x);
 
 // Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline in N points
-template <size_t N>
-std::array<Point2D, N> SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3)
+template <size_t N, typename T>
+std::array<Point2DT<T>, N> SubdivideCatmullRomSpline(const Point2DT<T>& p0, const Point2DT<T>& p1, const Point2DT<T>& p2, const Point2DT<T>& p3)
 {
-	std::array<Point2D, N> points;
+	std::array<Point2DT<T>, N> points;
 
 	for (int n = 0; n < points.size(); n++)
 	{
-		const double t = double(n + 1) / (N + 1);
+		const T t = T(n + 1) / (N + 1);
 		points[n] = SubdivideCatmullRomSpline(p0, p1, p2, p3, t);
 	}
 
@@ -30,14 +34,14 @@ std::array<Point2D, N> SubdivideCatmullRomSpline(const Point2D& p0, const Point2
 }
 
 // Subdivide the segment between p1 and p2 using a chordal Catmull-Rom spline in N points
-template <size_t N>
-std::array<Point3D, N> SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3)
+template <size_t N, typename T>
+std::array<Point3DT<T>, N> SubdivideCatmullRomSpline(const Point3DT<T>& p0, const Point3DT<T>& p1, const Point3DT<T>& p2, const Point3DT<T>& p3)
 {
-	std::array<Point3D, N> points;
+	std::array<Point3DT<T>, N> points;
 
 	for (int n = 0; n < points.size(); n++)
 	{
-		const double t = double(n + 1) / (N + 1);
+		const T t = T(n + 1) / (N + 1);
 		points[n] = SubdivideCatmullRomSpline(p0, p1, p2, p3, t);
 	}
 
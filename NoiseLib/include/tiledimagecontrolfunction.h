@@ -0,0 +1,164 @@
+#ifndef TILEDIMAGECONTROLFUNCTION_H
+#define TILEDIMAGECONTROLFUNCTION_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "controlfunction.h"
+#include "mappedfile.h"
+
+/// <summary>
+/// Control function given by a grayscale image stored in a tiled file, interpolated with a bicubic filter.
+/// The file is mapped in memory, and only the tiles that are evaluated are read, so images
+/// larger than the memory can be used. Like ImageControlFunction, the file contains a pyramid
+/// of images, each one half the size of the previous one, read by evaluations with a footprint.
+/// Files are created from images of type CV_8U or CV_16U with the function convert.
+/// </summary>
+class TiledImageControlFunction : public ControlFunction<TiledImageControlFunction>
+{
+	friend class ControlFunction<TiledImageControlFunction>;
+
+public:
+	static const int DEFAULT_TILE_SIZE = 256;
+	static const int MAX_TILE_SIZE = 1 << 15;
+
+	/// <summary>
+	/// Map a tiled file in memory. The header and the position of the images are checked
+	/// against the size of the file, and std::runtime_error is thrown if the file cannot be
+	/// mapped, or if it is not a valid tiled file.
+	/// </summary>
+	/// <param name="filename">Name of a file written by convert</param>
+	explicit TiledImageControlFunction(const std::string& filename);
+
+	/// <summary>
+	/// Write an image and its pyramid in a tiled file
+	/// </summary>
+	/// <param name="image">Image of type CV_8U or CV_16U</param>
+	/// <param name="filename">Name of the tiled file</param>
+	/// <param name="tileSize">Number of pixels in a row and in a column of a tile, a power of two up to MAX_TILE_SIZE</param>
+	/// <returns>True if the file was written</returns>
+	static bool convert(const cv::Mat& image, const std::string& filename, int tileSize = DEFAULT_TILE_SIZE);
+
+protected:
+	double EvaluateImpl(double x, double y) const
+	{
+		return EvaluateFilteredImpl(x, y, 0.0);
+	}
+
+	double EvaluateFilteredImpl(double x, double y, double footprint) const;
+
+	bool InsideDomainImpl(double x, double y) const
+	{
+		return x >= 0.0 && x <= 1.0 && y >= 0.0 && y <= 1.0;
+	}
+
+	void EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+	{
+		EvaluateFilteredBatchImpl(x, y, values, n, 0.0);
+	}
+
+	void EvaluateFilteredBatchImpl(const double* x, const double* y, double* values, int n, double footprint) const;
+
+	void InsideDomainBatchImpl(const double* x, const double* y, bool* inside, int n) const
+	{
+		for (int k = 0; k < n; k++)
+		{
+			inside[k] = (x[k] >= 0.0) & (x[k] <= 1.0) & (y[k] >= 0.0) & (y[k] <= 1.0);
+		}
+	}
+
+	double DistToDomainImpl(double x, double y) const
+	{
+		// Distance to the nearest point of the square [0, 1] x [0, 1]
+		const double dx = std::max({ 0.0, -x, x - 1.0 });
+		const double dy = std::max({ 0.0, -y, y - 1.0 });
+
+		return std::hypot(dx, dy);
+	}
+
+	double MinimumImpl() const
+	{
+		return 0.0;
+	}
+
+	double MaximumImpl() const
+	{
+		return 1.0;
+	}
+
+	void PrefetchImpl(double xMin, double yMin, double xMax, double yMax, double footprint) const;
+
+private:
+	// Maximum number of images in the pyramid of a file
+	static const int MAX_FILE_LEVELS = 32;
+
+	// Alignment of the header and of the images in the file
+	static const int FILE_ALIGNMENT = 4096;
+
+	// Image of the pyramid, as it is stored in the file
+	struct FileLevel
+	{
+		uint32_t rows;
+		uint32_t cols;
+		uint32_t tilesX;
+		uint32_t tilesY;
+		// Offset of the first tile in the file, tiles are stored row by row
+		uint64_t offset;
+	};
+
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t bytesPerPixel;
+		uint32_t tileSize;
+		uint32_t levelCount;
+		uint32_t reserved;
+		FileLevel levels[MAX_FILE_LEVELS];
+	};
+
+	struct Level
+	{
+		int rows;
+		int cols;
+		int tilesX;
+		int tilesY;
+		// Offset of the first tile in the file
+		size_t offset;
+		// Largest distance between two texels in the [0, 1] x [0, 1] domain
+		double texelSize;
+	};
+
+	// Index of the coarsest image of the pyramid whose texels are not larger than the footprint
+	size_t PyramidLevel(double footprint) const;
+
+	// Sample an image whose pixels are of type P
+	template <typename P>
+	double Sample(const Level& level, double ri, double rj) const;
+
+	template <typename P>
+	void SampleBatch(const Level& level, const double* x, const double* y, double* values, int n) const;
+
+	template <typename P>
+	static bool Convert(const cv::Mat& image, const std::string& filename, int tileSize);
+
+	const std::unique_ptr<MappedFile> m_file;
+
+	int m_bytesPerPixel;
+
+	// Number of pixels in a row and in a column of a tile, and its base 2 logarithm
+	int m_tileSize;
+	int m_tileShift;
+
+	// Images from the full resolution image to a 2x2 image
+	std::vector<Level> m_pyramid;
+};
+
+#endif // TILEDIMAGECONTROLFUNCTION_H
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <array>
+#include <cstddef>
 
 template<typename T>
 T remap(const T& x, const T& in_start, const T& in_end, const T& out_start, const T& out_end)
@@ -96,12 +97,33 @@ T WyvillGalinFunction(const T& distance, const T& R, const T& N)
 	return alpha;
 }
 
+// Wyvill-Galin function and its derivative with respect to the distance
+template<typename T>
+T WyvillGalinFunction(const T& distance, const T& R, const T& N, T& derivative)
+{
+	T alpha = 0.0;
+	derivative = 0.0;
+
+	if (distance < R)
+	{
+		const T base = 1 - (distance / R) * (distance / R);
+		alpha = pow(base, N);
+		derivative = -2 * N * distance / (R * R) * pow(base, N - 1);
+	}
+
+	return alpha;
+}
+
 double cubic_interpolate(double p0, double p1, double p2, double p3, double t);
 
 double cubic_interpolate(const std::array<double, 4>& p, double t);
 
 double bi_cubic_interpolate(const std::array<std::array<double, 4>, 4>& p, double u, double v);
 
+// Bicubic interpolation of the 4x4 values at p in a raster whose rows are stride values apart.
+// The four rows are interpolated together.
+double bi_cubic_interpolate(const double* p, std::ptrdiff_t stride, double u, double v);
+
 // Equivalent of the Jet coloring in Matlab.
 std::array<double, 3> matlab_jet(double u);
 
@@ -0,0 +1,130 @@
+#include "controlfunctioncache.h"
+
+#include <cstring>
+
+#include "randomgenerator.h"
+
+ControlFunctionCache::ControlFunctionCache(size_t capacity) :
+	m_hits(0),
+	m_misses(0)
+{
+	size_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+
+	m_entries.resize(size);
+}
+
+bool ControlFunctionCache::findElevation(const Point2D& point, double footprint, double& elevation) const
+{
+	const size_t slot = Slot(point);
+
+	bool found = false;
+	{
+		const std::lock_guard<std::mutex> lock(SlotMutex(slot));
+
+		const Entry& entry = m_entries[slot];
+		// Points are compared exactly, the entry must be the value of this very point
+		if (entry.hasElevation && entry.point.x == point.x && entry.point.y == point.y && entry.footprint == footprint)
+		{
+			elevation = entry.elevation;
+			found = true;
+		}
+	}
+
+	(found ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+
+	return found;
+}
+
+void ControlFunctionCache::storeElevation(const Point2D& point, double footprint, double elevation)
+{
+	const size_t slot = Slot(point);
+
+	const std::lock_guard<std::mutex> lock(SlotMutex(slot));
+
+	Entry& entry = ClaimSlot(slot, point);
+	entry.footprint = footprint;
+	entry.elevation = elevation;
+	entry.hasElevation = true;
+}
+
+bool ControlFunctionCache::findInsideDomain(const Point2D& point, bool& inside) const
+{
+	const size_t slot = Slot(point);
+
+	bool found = false;
+	{
+		const std::lock_guard<std::mutex> lock(SlotMutex(slot));
+
+		const Entry& entry = m_entries[slot];
+		if (entry.hasInside && entry.point.x == point.x && entry.point.y == point.y)
+		{
+			inside = entry.inside;
+			found = true;
+		}
+	}
+
+	(found ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+
+	return found;
+}
+
+void ControlFunctionCache::storeInsideDomain(const Point2D& point, bool inside)
+{
+	const size_t slot = Slot(point);
+
+	const std::lock_guard<std::mutex> lock(SlotMutex(slot));
+
+	Entry& entry = ClaimSlot(slot, point);
+	entry.inside = inside;
+	entry.hasInside = true;
+}
+
+ControlFunctionCache::Statistics ControlFunctionCache::statistics() const
+{
+	return { m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed) };
+}
+
+void ControlFunctionCache::clear()
+{
+	for (size_t slot = 0; slot < m_entries.size(); slot++)
+	{
+		const std::lock_guard<std::mutex> lock(SlotMutex(slot));
+
+		m_entries[slot] = Entry();
+	}
+
+	m_hits = 0;
+	m_misses = 0;
+}
+
+size_t ControlFunctionCache::Slot(const Point2D& point) const
+{
+	uint64_t x, y;
+	std::memcpy(&x, &point.x, sizeof(x));
+	std::memcpy(&y, &point.y, sizeof(y));
+
+	return size_t(MixBits(x ^ MixBits(y))) & (m_entries.size() - 1);
+}
+
+std::mutex& ControlFunctionCache::SlotMutex(size_t slot) const
+{
+	return m_mutexes[slot % MUTEX_COUNT];
+}
+
+ControlFunctionCache::Entry& ControlFunctionCache::ClaimSlot(size_t slot, const Point2D& point)
+{
+	Entry& entry = m_entries[slot];
+
+	// Replace the values of another point
+	if (entry.point.x != point.x || entry.point.y != point.y)
+	{
+		entry = Entry();
+		entry.point = point;
+	}
+
+	return entry;
+}
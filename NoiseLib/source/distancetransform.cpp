@@ -0,0 +1,90 @@
+#include "distancetransform.h"
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+
+namespace
+{
+	/// <summary>
+	/// Transform of n samples, stride values apart, with the lower envelope of the parabolas rooted at the samples
+	/// </summary>
+	void Transform1D(double* values, int n, std::ptrdiff_t stride, double spacing, std::vector<double>& f, std::vector<int>& roots, std::vector<double>& bounds)
+	{
+		const double infinity = std::numeric_limits<double>::infinity();
+		const double spacingSq = spacing * spacing;
+
+		f.resize(n);
+		roots.resize(n);
+		bounds.resize(std::size_t(n) + 1);
+
+		// Only finite samples have a parabola
+		int parabolas = 0;
+		for (int q = 0; q < n; q++)
+		{
+			f[q] = values[q * stride];
+			if (f[q] == infinity)
+			{
+				continue;
+			}
+
+			// Remove the parabolas hidden by the one rooted at q
+			double s = -infinity;
+			while (parabolas > 0)
+			{
+				const int r = roots[parabolas - 1];
+				s = ((f[q] + spacingSq * q * q) - (f[r] + spacingSq * r * r)) / (2.0 * spacingSq * (q - r));
+				if (s > bounds[parabolas - 1])
+				{
+					break;
+				}
+
+				parabolas--;
+				s = -infinity;
+			}
+
+			roots[parabolas] = q;
+			bounds[parabolas] = s;
+			parabolas++;
+		}
+
+		if (parabolas == 0)
+		{
+			return;
+		}
+
+		bounds[parabolas] = infinity;
+
+		int k = 0;
+		for (int p = 0; p < n; p++)
+		{
+			while (bounds[k + 1] < p)
+			{
+				k++;
+			}
+
+			const double d = spacing * (p - roots[k]);
+			values[p * stride] = d * d + f[roots[k]];
+		}
+	}
+}
+
+void squaredDistanceTransform(std::vector<double>& values, int width, int height, double spacingX, double spacingY)
+{
+	assert(values.size() == std::size_t(width) * height);
+
+	std::vector<double> f;
+	std::vector<int> roots;
+	std::vector<double> bounds;
+
+	// Columns, then rows
+	for (int j = 0; j < width; j++)
+	{
+		Transform1D(values.data() + j, height, width, spacingY, f, roots, bounds);
+	}
+
+	for (int i = 0; i < height; i++)
+	{
+		Transform1D(values.data() + std::size_t(i) * width, width, 1, spacingX, f, roots, bounds);
+	}
+}
@@ -1,50 +1,165 @@
 #include "imagecontrolfunction.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 
-double ImageControlFunction::sample(double ri, double rj) const
+ImageControlFunction::ImageControlFunction(const cv::Mat& image)
+{
+	assert(image.data != nullptr);
+	assert(image.type() == CV_8U || image.type() == CV_16U);
+	assert(image.rows > 1);
+	assert(image.cols > 1);
+
+	switch (image.type())
+	{
+	case CV_8U:
+		m_pyramid.push_back(Decode<uint8_t>(image));
+		break;
+	case CV_16U:
+		m_pyramid.push_back(Decode<uint16_t>(image));
+		break;
+	}
+
+	while (m_pyramid.back().rows() > 2 || m_pyramid.back().cols() > 2)
+	{
+		m_pyramid.push_back(Downsample(m_pyramid.back()));
+	}
+}
+
+void ImageControlFunction::EvaluateBatchImpl(const double* x, const double* y, double* values, int n) const
+{
+	for (int k = 0; k < n; k++)
+	{
+		values[k] = sample(m_pyramid.front(), std::clamp(y[k], 0.0, 1.0), std::clamp(x[k], 0.0, 1.0));
+	}
+}
+
+void ImageControlFunction::EvaluateFilteredBatchImpl(const double* x, const double* y, double* values, int n, double footprint) const
+{
+	// All the points have the same footprint and read the same raster
+	const Raster& raster = m_pyramid[PyramidLevel(footprint)];
+
+	for (int k = 0; k < n; k++)
+	{
+		values[k] = sample(raster, std::clamp(y[k], 0.0, 1.0), std::clamp(x[k], 0.0, 1.0));
+	}
+}
+
+ImageControlFunction::Raster::Raster(int rows, int cols) :
+	m_rows(rows),
+	m_cols(cols),
+	m_stride(0),
+	m_origin(0)
+{
+	const int width = m_cols + BORDER_BEFORE + BORDER_AFTER;
+	const int height = m_rows + BORDER_BEFORE + BORDER_AFTER;
+
+	m_stride = (width + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+
+	// Allocate enough values to start the raster on an aligned address
+	m_texels.assign(size_t(height) * m_stride + ROW_ALIGNMENT, 0.0);
+
+	const size_t alignment = ROW_ALIGNMENT * sizeof(double);
+	const size_t misalignment = reinterpret_cast<uintptr_t>(m_texels.data()) % alignment;
+	m_origin = misalignment == 0 ? 0 : (alignment - misalignment) / sizeof(double);
+}
+
+void ImageControlFunction::Raster::clampBorders()
+{
+	for (int i = -BORDER_BEFORE; i < m_rows + BORDER_AFTER; i++)
+	{
+		const int clampedI = std::clamp(i, 0, m_rows - 1);
+
+		for (int j = -BORDER_BEFORE; j < m_cols + BORDER_AFTER; j++)
+		{
+			const int clampedJ = std::clamp(j, 0, m_cols - 1);
+
+			if (i != clampedI || j != clampedJ)
+			{
+				at(i, j) = get(clampedI, clampedJ);
+			}
+		}
+	}
+}
+
+template <typename P>
+ImageControlFunction::Raster ImageControlFunction::Decode(const cv::Mat& image)
+{
+	Raster raster(image.rows, image.cols);
+
+	for (int i = 0; i < image.rows; i++)
+	{
+		const P* row = image.ptr<P>(i);
+
+		for (int j = 0; j < image.cols; j++)
+		{
+			// Remap the value between 0 and 1
+			raster.at(i, j) = double(row[j]) / std::numeric_limits<P>::max();
+		}
+	}
+
+	raster.clampBorders();
+
+	return raster;
+}
+
+ImageControlFunction::Raster ImageControlFunction::Downsample(const Raster& raster)
+{
+	// Keep at least two texels per axis for the interpolation
+	Raster downsampled(std::max((raster.rows() + 1) / 2, 2), std::max((raster.cols() + 1) / 2, 2));
+
+	for (int i = 0; i < downsampled.rows(); i++)
+	{
+		const int i0 = std::min(2 * i, raster.rows() - 1);
+		const int i1 = std::min(2 * i + 1, raster.rows() - 1);
+
+		for (int j = 0; j < downsampled.cols(); j++)
+		{
+			const int j0 = std::min(2 * j, raster.cols() - 1);
+			const int j1 = std::min(2 * j + 1, raster.cols() - 1);
+
+			downsampled.at(i, j) = 0.25 * (raster.get(i0, j0) + raster.get(i0, j1) + raster.get(i1, j0) + raster.get(i1, j1));
+		}
+	}
+
+	downsampled.clampBorders();
+
+	return downsampled;
+}
+
+size_t ImageControlFunction::PyramidLevel(double footprint) const
+{
+	size_t level = 0;
+	while (level + 1 < m_pyramid.size() && m_pyramid[level + 1].texelSize() <= footprint)
+	{
+		level++;
+	}
+
+	return level;
+}
+
+double ImageControlFunction::sample(const Raster& raster, double ri, double rj)
 {
 	assert(0.0 <= ri && ri <= 1.0);
 	assert(0.0 <= rj && rj <= 1.0);
 
-	ri *= m_image.rows - 1;
-	rj *= m_image.cols - 1;
+	ri *= raster.rows() - 1;
+	rj *= raster.cols() - 1;
 
 	// If the coordinates are integer, return directly the value
 	if (nearbyint(ri) == ri && nearbyint(rj) == rj)
 	{
-		return get(int(ri), int(rj));
+		return raster.get(int(ri), int(rj));
 	}
 
 	const auto i1 = int(floor(ri));
 	const auto j1 = int(floor(rj));
 
-	// i = {i1 - 1, i1, i1 + 1, i1 + 2}
-	const std::array<int, 4> i = {
-		std::max(i1 - 1, 0),
-		i1,
-		std::min(i1 + 1, m_image.rows - 1),
-		std::min(i1 + 2, m_image.rows - 1)
-	};
-
-	// j = {j1 - 1, j1, j1 + 1, j1 + 2}
-	const std::array<int, 4> j = {
-		std::max(j1 - 1, 0),
-		j1,
-		std::min(j1 + 1, m_image.cols - 1),
-		std::min(j1 + 2, m_image.cols - 1)
-	};
-
-	std::array<std::array<double, 4>, 4> p{};
-	for (int k = 0; k < 4; k++)
-	{
-		for (int l = 0; l < 4; l++)
-		{
-			p[k][l] = get(i[k], j[l]);
-		}
-	}
+	// The texels {i1 - 1, ..., i1 + 2} x {j1 - 1, ..., j1 + 2} are in the raster thanks to its borders
+	const double* p = raster.texel(i1 - 1, j1 - 1);
 
-	const double interpolation = bi_cubic_interpolate(p, ri - floor(ri), rj - floor(rj));
+	const double interpolation = bi_cubic_interpolate(p, raster.stride(), ri - floor(ri), rj - floor(rj));
 
 	return std::clamp(interpolation, 0.0, 1.0);
 }
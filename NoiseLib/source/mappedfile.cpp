@@ -0,0 +1,142 @@
+#include "mappedfile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+// PrefetchVirtualMemory needs Windows 8
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0602
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) :
+	m_data(nullptr),
+	m_size(0),
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr)
+{
+	m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		return;
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = m_data != nullptr ? size_t(size.QuadPart) : 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	if (m_data == nullptr || offset >= m_size)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t*>(m_data) + offset;
+	range.NumberOfBytes = std::min(size, m_size - offset);
+
+	// Only a hint, a failure is ignored
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) :
+	m_data(nullptr),
+	m_size(0),
+	m_file(-1)
+{
+	m_file = open(filename.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		return;
+	}
+
+	struct stat status;
+	if (fstat(m_file, &status) != 0 || status.st_size == 0)
+	{
+		return;
+	}
+
+	void* data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, m_file, 0);
+	if (data == MAP_FAILED)
+	{
+		return;
+	}
+
+	// Evaluations read the tiles of the file in no particular order
+	madvise(data, size_t(status.st_size), MADV_RANDOM);
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = size_t(status.st_size);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+
+	if (m_file >= 0)
+	{
+		close(m_file);
+	}
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	if (m_data == nullptr || offset >= m_size)
+	{
+		return;
+	}
+
+	// madvise needs an address aligned on a page
+	const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	const size_t begin = offset / pageSize * pageSize;
+	const size_t end = std::min(offset + size, m_size);
+
+	madvise(const_cast<uint8_t*>(m_data) + begin, end - begin, MADV_WILLNEED);
+}
+
+#endif
@@ -2,37 +2,25 @@
 
 #include <algorithm>
 
-Point2D& Point2D::operator+=(const Vec2D& v)
+template <typename T>
+T angle(const Point2DT<T>& a, const Point2DT<T>& o, const Point2DT<T>& b)
 {
-	x += v.x;
-	y += v.y;
-	return *this;
-}
-
-Point2D& Point2D::operator-=(const Vec2D& v)
-{
-	x -= v.x;
-	y -= v.y;
-	return *this;
-}
-
-double angle(const Point2D& a, const Point2D& o, const Point2D& b)
-{
-	const Vec2D oa(o, a);
-	const Vec2D ob(o, b);
+	const Vec2DT<T> oa(o, a);
+	const Vec2DT<T> ob(o, b);
 	return angle(oa, ob);
 }
 
-double pointLineProjection(const Point2D& p, const Point2D& a, const Point2D& b)
+template <typename T>
+T pointLineProjection(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b)
 {
-	const Vec2D ap(a, p);
-	const Vec2D ab(a, b);
+	const Vec2DT<T> ap(a, p);
+	const Vec2DT<T> ab(a, b);
 
 	// Segment is only a point and has no length
-	if (norm_sq(ab) <= 0.0)
+	if (norm_sq(ab) <= T(0.0))
 	{
 		// The nearest point on the segment is A (or B)
-		return 0.0;
+		return T(0.0);
 	}
 
 	// Segment has a length greater than 0
@@ -40,45 +28,50 @@ double pointLineProjection(const Point2D& p, const Point2D& a, const Point2D& b)
 	return dot(ap, ab) / norm_sq(ab);
 }
 
-double pointLineProjection(const Point2D& p, const Segment2D& s)
+template <typename T>
+T pointLineProjection(const Point2DT<T>& p, const Segment2DT<T>& s)
 {
 	return pointLineProjection(p, s.a, s.b);
 }
 
-double pointLineSegmentProjection(const Point2D& p, const Point2D& a, const Point2D& b)
+template <typename T>
+T pointLineSegmentProjection(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b)
 {
-	const double u = pointLineProjection(p, a, b);
-	return std::clamp(u, 0.0, 1.0);
+	const T u = pointLineProjection(p, a, b);
+	return std::clamp(u, T(0.0), T(1.0));
 }
 
-double pointLineSegmentProjection(const Point2D& p, const Segment2D& s)
+template <typename T>
+T pointLineSegmentProjection(const Point2DT<T>& p, const Segment2DT<T>& s)
 {
 	return pointLineSegmentProjection(p, s.a, s.b);
 }
 
-double distToLine(const Point2D& p, const Point2D& a, const Point2D& b, Point2D& c)
+template <typename T>
+T distToLine(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b, Point2DT<T>& c)
 {
-	const Vec2D ab(a, b);
-	const double u = pointLineProjection(p, a, b);
+	const Vec2DT<T> ab(a, b);
+	const T u = pointLineProjection(p, a, b);
 
 	c = a + ab * u;
 
 	return dist(p, c);
 }
 
-double distToLineSegment(const Point2D& p, const Point2D& a, const Point2D& b, Point2D& c)
+template <typename T>
+T distToLineSegment(const Point2DT<T>& p, const Point2DT<T>& a, const Point2DT<T>& b, Point2DT<T>& c)
 {
-	const Vec2D ab(a, b);
-	const double u = pointLineProjection(p, a, b);
+	const Vec2DT<T> ab(a, b);
+	const T u = pointLineProjection(p, a, b);
 
-	if (u < 0.0)
+	if (u < T(0.0))
 	{
 		// P is closer to A
 		c = a;
 		return dist(p, a);
 	}
 	
-	if (u > 1.0)
+	if (u > T(1.0))
 	{
 		// P is closer to B
 		c = b;
@@ -90,7 +83,22 @@ double distToLineSegment(const Point2D& p, const Point2D& a, const Point2D& b, P
 	return dist(p, c);
 }
 
-double distToLineSegment(const Point2D& p, const Segment2D& s, Point2D& c)
+template <typename T>
+T distToLineSegment(const Point2DT<T>& p, const Segment2DT<T>& s, Point2DT<T>& c)
 {
 	return distToLineSegment(p, s.a, s.b, c);
 }
+
+// Instantiations in double and single precision
+#define INSTANTIATE_MATH2D(T) \
+	template T angle(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&); \
+	template T pointLineProjection(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&); \
+	template T pointLineProjection(const Point2DT<T>&, const Segment2DT<T>&); \
+	template T pointLineSegmentProjection(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&); \
+	template T pointLineSegmentProjection(const Point2DT<T>&, const Segment2DT<T>&); \
+	template T distToLine(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, Point2DT<T>&); \
+	template T distToLineSegment(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, Point2DT<T>&); \
+	template T distToLineSegment(const Point2DT<T>&, const Segment2DT<T>&, Point2DT<T>&);
+
+INSTANTIATE_MATH2D(double)
+INSTANTIATE_MATH2D(float)
@@ -1,17 +1,10 @@
 #include "math3d.h"
 
-Point3D& Point3D::operator+=(const Vec3D& v)
-{
-	x += v.x;
-	y += v.y;
-	z += v.z;
-	return *this;
-}
+// Instantiations in double and single precision
+template struct Point3DT<double>;
+template struct Vec3DT<double>;
+template struct Segment3DT<double>;
 
-Point3D& Point3D::operator-=(const Vec3D& v)
-{
-	x -= v.x;
-	y -= v.y;
-	z -= v.z;
-	return *this;
-}
+template struct Point3DT<float>;
+template struct Vec3DT<float>;
+template struct Segment3DT<float>;
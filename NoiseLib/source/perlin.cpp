@@ -1,21 +1,27 @@
 #include "perlin.h"
 
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERLIN_AVX2
+#include <immintrin.h>
+#define PERLIN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define PERLIN_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#define PERLIN_TARGET_AVX2
+#endif
+
 #include "utils.h"
 
 const double unit = 1.0 / sqrt(2);
-const double Gradients[][2] = {
-	{ unit, unit },
-	{ -unit, unit },
-	{ unit, -unit },
-	{ -unit, -unit },
-	{ 1, 0 },
-	{ -1, 0 },
-	{ 0, 1 },
-	{ 0, -1 }
-};
+
+// Coordinates of the gradients, split for the vector gathers
+const double GradientsX[8] = { unit, -unit, unit, -unit, 1, -1, 0, 0 };
+const double GradientsY[8] = { unit, unit, -unit, -unit, 0, 0, 1, -1 };
 
 const uint8_t HashTable[256] = {
 	151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225, 140,  36, 103,  30,  69, 
@@ -33,46 +39,397 @@ const uint8_t HashTable[256] = {
 	 61, 156, 180, 219
 };
 
-// Computes the dot product of the distance and gradient vectors.
-double dotGridGradient(int ix, int iy, double x, double y)
+/// <summary>
+/// HashTable repeated twice, so that Permutation[i + Permutation[j]] needs no modulo
+/// for i and j in [0, 256]. Stored as int32_t for the vector gathers.
+/// </summary>
+struct PermutationTable
 {
-	const int mx = robust_mod(ix, 256);
-	const int my = robust_mod(iy, 256);
+	int32_t values[512];
 
-	const int index = robust_mod(mx + HashTable[my], 256);
-
-	// Index of the gradient
-	int g = HashTable[index] % 8;
+	PermutationTable()
+	{
+		for (int k = 0; k < 512; k++)
+		{
+			values[k] = HashTable[k % 256];
+		}
+	}
+};
 
-	// Compute the distance vector
-	double dx = x - (double)ix;
-	double dy = y - (double)iy;
-
-	// Compute the dot-product
-	return (dx * Gradients[g][0] + dy * Gradients[g][1]);
-}
+const PermutationTable Permutation;
 
 // Compute Perlin noise at coordinates x, y
 double Perlin(double x, double y)
 {
 	// Determine grid cell coordinates
-	int x0 = int(floor(x));
-	int x1 = x0 + 1;
-	int y0 = int(floor(y));
-	int y1 = y0 + 1;
+	const double fx = floor(x);
+	const double fy = floor(y);
+	const int i = int(fx) & 255;
+	const int j = int(fy) & 255;
+
+	// Index of the gradients at the corners of the cell
+	const int32_t* p = Permutation.values;
+	const int g00 = p[i + p[j]] & 7;
+	const int g10 = p[i + 1 + p[j]] & 7;
+	const int g01 = p[i + p[j + 1]] & 7;
+	const int g11 = p[i + 1 + p[j + 1]] & 7;
 
-	// Determine interpolation weights
-	// Could also use higher order polynomial/s-curve here
-	double sx = x - floor(x);
-	double sy = y - floor(y);
+	// Distance vectors to the corners
+	const double dx0 = x - fx;
+	const double dx1 = x - (fx + 1.0);
+	const double dy0 = y - fy;
+	const double dy1 = y - (fy + 1.0);
 
-	double s = dotGridGradient(x0, y0, x, y);
-	double t = dotGridGradient(x1, y0, x, y);
-	double u = dotGridGradient(x0, y1, x, y);
-	double v = dotGridGradient(x1, y1, x, y);
+	// Dot products of the distance and gradient vectors
+	const double s = dx0 * GradientsX[g00] + dy0 * GradientsY[g00];
+	const double t = dx1 * GradientsX[g10] + dy0 * GradientsY[g10];
+	const double u = dx0 * GradientsX[g01] + dy1 * GradientsY[g01];
+	const double v = dx1 * GradientsX[g11] + dy1 * GradientsY[g11];
 
 	// Interpolate between grid point gradients
-	double ix0 = lerp(s, t, smoother(sx));
-	double ix1 = lerp(u, v, smoother(sx));
-	return lerp(ix0, ix1, smoother(sy));
+	const double sx = smoother(dx0);
+	const double sy = smoother(dy0);
+	const double ix0 = lerp(s, t, sx);
+	const double ix1 = lerp(u, v, sx);
+	return lerp(ix0, ix1, sy);
+}
+
+double Perlin(double x, double y, double& dx, double& dy)
+{
+	const double fx = floor(x);
+	const double fy = floor(y);
+	const int i = int(fx) & 255;
+	const int j = int(fy) & 255;
+
+	const int32_t* p = Permutation.values;
+	const int g00 = p[i + p[j]] & 7;
+	const int g10 = p[i + 1 + p[j]] & 7;
+	const int g01 = p[i + p[j + 1]] & 7;
+	const int g11 = p[i + 1 + p[j + 1]] & 7;
+
+	const double dx0 = x - fx;
+	const double dx1 = x - (fx + 1.0);
+	const double dy0 = y - fy;
+	const double dy1 = y - (fy + 1.0);
+
+	const double s = dx0 * GradientsX[g00] + dy0 * GradientsY[g00];
+	const double t = dx1 * GradientsX[g10] + dy0 * GradientsY[g10];
+	const double u = dx0 * GradientsX[g01] + dy1 * GradientsY[g01];
+	const double v = dx1 * GradientsX[g11] + dy1 * GradientsY[g11];
+
+	const double sx = smoother(dx0);
+	const double sy = smoother(dy0);
+	const double ix0 = lerp(s, t, sx);
+	const double ix1 = lerp(u, v, sx);
+
+	// Derivatives of the smoother interpolation weights
+	const double dsx = 30.0 * dx0 * dx0 * (dx0 - 1.0) * (dx0 - 1.0);
+	const double dsy = 30.0 * dy0 * dy0 * (dy0 - 1.0) * (dy0 - 1.0);
+
+	// Derivatives of the interpolations along x, the dot products are linear in x and y
+	const double ix0dx = GradientsX[g00] + sx * (GradientsX[g10] - GradientsX[g00]) + dsx * (t - s);
+	const double ix1dx = GradientsX[g01] + sx * (GradientsX[g11] - GradientsX[g01]) + dsx * (v - u);
+	const double ix0dy = GradientsY[g00] + sx * (GradientsY[g10] - GradientsY[g00]);
+	const double ix1dy = GradientsY[g01] + sx * (GradientsY[g11] - GradientsY[g01]);
+
+	dx = ix0dx + sy * (ix1dx - ix0dx);
+	dy = ix0dy + sy * (ix1dy - ix0dy) + dsy * (ix1 - ix0);
+
+	return lerp(ix0, ix1, sy);
+}
+
+double PerlinFBm(double x, double y, int octaves, double lacunarity, double gain)
+{
+	assert(octaves >= 0 && octaves <= FBM_MAX_OCTAVES);
+
+	// Coordinates of the octaves, padded with zeros to fill the vectors of the batch
+	double octaveX[FBM_MAX_OCTAVES] = {};
+	double octaveY[FBM_MAX_OCTAVES] = {};
+	double values[FBM_MAX_OCTAVES];
+
+	double frequency = 1.0;
+	for (int k = 0; k < octaves; k++)
+	{
+		octaveX[k] = x * frequency;
+		octaveY[k] = y * frequency;
+		frequency *= lacunarity;
+	}
+
+	Perlin(octaveX, octaveY, values, size_t((octaves + 3) / 4 * 4));
+
+	double value = 0.0;
+	double amplitude = 1.0;
+	for (int k = 0; k < octaves; k++)
+	{
+		value += amplitude * values[k];
+		amplitude *= gain;
+	}
+
+	return value;
+}
+
+double PerlinFBm(double x, double y, int octaves, double lacunarity, double gain, double& dx, double& dy)
+{
+	assert(octaves >= 0 && octaves <= FBM_MAX_OCTAVES);
+
+	// Coordinates of the octaves, padded with zeros to fill the vectors of the batch
+	double octaveX[FBM_MAX_OCTAVES] = {};
+	double octaveY[FBM_MAX_OCTAVES] = {};
+	double values[FBM_MAX_OCTAVES];
+	double octaveDx[FBM_MAX_OCTAVES];
+	double octaveDy[FBM_MAX_OCTAVES];
+
+	double frequency = 1.0;
+	for (int k = 0; k < octaves; k++)
+	{
+		octaveX[k] = x * frequency;
+		octaveY[k] = y * frequency;
+		frequency *= lacunarity;
+	}
+
+	Perlin(octaveX, octaveY, values, octaveDx, octaveDy, size_t((octaves + 3) / 4 * 4));
+
+	double value = 0.0;
+	dx = 0.0;
+	dy = 0.0;
+
+	frequency = 1.0;
+	double amplitude = 1.0;
+	for (int k = 0; k < octaves; k++)
+	{
+		value += amplitude * values[k];
+
+		// Chain rule for the scaled coordinates
+		dx += amplitude * frequency * octaveDx[k];
+		dy += amplitude * frequency * octaveDy[k];
+
+		frequency *= lacunarity;
+		amplitude *= gain;
+	}
+
+	return value;
+}
+
+#ifdef PERLIN_AVX2
+
+namespace
+{
+	bool HasAVX2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// The system must save the AVX registers
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	PERLIN_TARGET_AVX2 inline __m256d SmootherAVX2(__m256d t)
+	{
+		const __m256d t3 = _mm256_mul_pd(_mm256_mul_pd(t, t), t);
+		const __m256d polynomial = _mm256_add_pd(_mm256_mul_pd(t, _mm256_sub_pd(_mm256_mul_pd(t, _mm256_set1_pd(6.0)), _mm256_set1_pd(15.0))), _mm256_set1_pd(10.0));
+
+		return _mm256_mul_pd(t3, polynomial);
+	}
+
+	PERLIN_TARGET_AVX2 inline __m256d LerpAVX2(__m256d a, __m256d b, __m256d t)
+	{
+		return _mm256_add_pd(_mm256_mul_pd(t, b), _mm256_sub_pd(a, _mm256_mul_pd(a, t)));
+	}
+
+	PERLIN_TARGET_AVX2 inline __m256d GatherAVX2(const double* table, __m128i g)
+	{
+		// Masked gather with all the lanes enabled, the unmasked one leaves its source register uninitialized
+		const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+		return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, g, all, 8);
+	}
+
+	PERLIN_TARGET_AVX2 inline __m256d DotAVX2(__m256d gx, __m256d gy, __m256d dx, __m256d dy)
+	{
+		return _mm256_add_pd(_mm256_mul_pd(dx, gx), _mm256_mul_pd(dy, gy));
+	}
+
+	/// <summary>
+	/// Cells of 4 points, and indices of the gradients at their corners, computed like the scalar Perlin function
+	/// </summary>
+	struct CellsAVX2
+	{
+		__m256d fx;
+		__m256d fy;
+		__m128i g00;
+		__m128i g10;
+		__m128i g01;
+		__m128i g11;
+	};
+
+	PERLIN_TARGET_AVX2 inline CellsAVX2 ComputeCellsAVX2(__m256d vx, __m256d vy)
+	{
+		const int* p = Permutation.values;
+		const __m128i mask = _mm_set1_epi32(255);
+		const __m128i gradientMask = _mm_set1_epi32(7);
+		const __m128i one = _mm_set1_epi32(1);
+
+		CellsAVX2 cells;
+		cells.fx = _mm256_floor_pd(vx);
+		cells.fy = _mm256_floor_pd(vy);
+		const __m128i i = _mm_and_si128(_mm256_cvttpd_epi32(cells.fx), mask);
+		const __m128i j = _mm_and_si128(_mm256_cvttpd_epi32(cells.fy), mask);
+
+		const __m128i pj0 = _mm_i32gather_epi32(p, j, 4);
+		const __m128i pj1 = _mm_i32gather_epi32(p, _mm_add_epi32(j, one), 4);
+		const __m128i i1 = _mm_add_epi32(i, one);
+
+		cells.g00 = _mm_and_si128(_mm_i32gather_epi32(p, _mm_add_epi32(i, pj0), 4), gradientMask);
+		cells.g10 = _mm_and_si128(_mm_i32gather_epi32(p, _mm_add_epi32(i1, pj0), 4), gradientMask);
+		cells.g01 = _mm_and_si128(_mm_i32gather_epi32(p, _mm_add_epi32(i, pj1), 4), gradientMask);
+		cells.g11 = _mm_and_si128(_mm_i32gather_epi32(p, _mm_add_epi32(i1, pj1), 4), gradientMask);
+
+		return cells;
+	}
+
+	// Same operations as the scalar Perlin function, on 4 points at once
+	PERLIN_TARGET_AVX2 size_t PerlinAVX2(const double* x, const double* y, double* out, size_t n)
+	{
+		size_t k = 0;
+		for (; k + 4 <= n; k += 4)
+		{
+			const __m256d vx = _mm256_loadu_pd(x + k);
+			const __m256d vy = _mm256_loadu_pd(y + k);
+			const CellsAVX2 cells = ComputeCellsAVX2(vx, vy);
+
+			const __m256d dx0 = _mm256_sub_pd(vx, cells.fx);
+			const __m256d dx1 = _mm256_sub_pd(vx, _mm256_add_pd(cells.fx, _mm256_set1_pd(1.0)));
+			const __m256d dy0 = _mm256_sub_pd(vy, cells.fy);
+			const __m256d dy1 = _mm256_sub_pd(vy, _mm256_add_pd(cells.fy, _mm256_set1_pd(1.0)));
+
+			const __m256d s = DotAVX2(GatherAVX2(GradientsX, cells.g00), GatherAVX2(GradientsY, cells.g00), dx0, dy0);
+			const __m256d t = DotAVX2(GatherAVX2(GradientsX, cells.g10), GatherAVX2(GradientsY, cells.g10), dx1, dy0);
+			const __m256d u = DotAVX2(GatherAVX2(GradientsX, cells.g01), GatherAVX2(GradientsY, cells.g01), dx0, dy1);
+			const __m256d v = DotAVX2(GatherAVX2(GradientsX, cells.g11), GatherAVX2(GradientsY, cells.g11), dx1, dy1);
+
+			const __m256d sx = SmootherAVX2(dx0);
+			const __m256d sy = SmootherAVX2(dy0);
+			const __m256d ix0 = LerpAVX2(s, t, sx);
+			const __m256d ix1 = LerpAVX2(u, v, sx);
+
+			_mm256_storeu_pd(out + k, LerpAVX2(ix0, ix1, sy));
+		}
+
+		return k;
+	}
+
+	// Derivative of the smoother function, with the operations of the scalar Perlin function
+	PERLIN_TARGET_AVX2 inline __m256d SmootherDerivativeAVX2(__m256d t)
+	{
+		const __m256d t1 = _mm256_sub_pd(t, _mm256_set1_pd(1.0));
+
+		return _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(30.0), t), t), t1), t1);
+	}
+
+	// Same operations as the scalar Perlin function with derivatives, on 4 points at once
+	PERLIN_TARGET_AVX2 size_t PerlinAVX2(const double* x, const double* y, double* out, double* outDx, double* outDy, size_t n)
+	{
+		size_t k = 0;
+		for (; k + 4 <= n; k += 4)
+		{
+			const __m256d vx = _mm256_loadu_pd(x + k);
+			const __m256d vy = _mm256_loadu_pd(y + k);
+			const CellsAVX2 cells = ComputeCellsAVX2(vx, vy);
+
+			const __m256d dx0 = _mm256_sub_pd(vx, cells.fx);
+			const __m256d dx1 = _mm256_sub_pd(vx, _mm256_add_pd(cells.fx, _mm256_set1_pd(1.0)));
+			const __m256d dy0 = _mm256_sub_pd(vy, cells.fy);
+			const __m256d dy1 = _mm256_sub_pd(vy, _mm256_add_pd(cells.fy, _mm256_set1_pd(1.0)));
+
+			const __m256d gx00 = GatherAVX2(GradientsX, cells.g00);
+			const __m256d gy00 = GatherAVX2(GradientsY, cells.g00);
+			const __m256d gx10 = GatherAVX2(GradientsX, cells.g10);
+			const __m256d gy10 = GatherAVX2(GradientsY, cells.g10);
+			const __m256d gx01 = GatherAVX2(GradientsX, cells.g01);
+			const __m256d gy01 = GatherAVX2(GradientsY, cells.g01);
+			const __m256d gx11 = GatherAVX2(GradientsX, cells.g11);
+			const __m256d gy11 = GatherAVX2(GradientsY, cells.g11);
+
+			const __m256d s = DotAVX2(gx00, gy00, dx0, dy0);
+			const __m256d t = DotAVX2(gx10, gy10, dx1, dy0);
+			const __m256d u = DotAVX2(gx01, gy01, dx0, dy1);
+			const __m256d v = DotAVX2(gx11, gy11, dx1, dy1);
+
+			const __m256d sx = SmootherAVX2(dx0);
+			const __m256d sy = SmootherAVX2(dy0);
+			const __m256d ix0 = LerpAVX2(s, t, sx);
+			const __m256d ix1 = LerpAVX2(u, v, sx);
+
+			const __m256d dsx = SmootherDerivativeAVX2(dx0);
+			const __m256d dsy = SmootherDerivativeAVX2(dy0);
+
+			const __m256d ix0dx = _mm256_add_pd(_mm256_add_pd(gx00, _mm256_mul_pd(sx, _mm256_sub_pd(gx10, gx00))), _mm256_mul_pd(dsx, _mm256_sub_pd(t, s)));
+			const __m256d ix1dx = _mm256_add_pd(_mm256_add_pd(gx01, _mm256_mul_pd(sx, _mm256_sub_pd(gx11, gx01))), _mm256_mul_pd(dsx, _mm256_sub_pd(v, u)));
+			const __m256d ix0dy = _mm256_add_pd(gy00, _mm256_mul_pd(sx, _mm256_sub_pd(gy10, gy00)));
+			const __m256d ix1dy = _mm256_add_pd(gy01, _mm256_mul_pd(sx, _mm256_sub_pd(gy11, gy01)));
+
+			_mm256_storeu_pd(outDx + k, _mm256_add_pd(ix0dx, _mm256_mul_pd(sy, _mm256_sub_pd(ix1dx, ix0dx))));
+			_mm256_storeu_pd(outDy + k, _mm256_add_pd(_mm256_add_pd(ix0dy, _mm256_mul_pd(sy, _mm256_sub_pd(ix1dy, ix0dy))), _mm256_mul_pd(dsy, _mm256_sub_pd(ix1, ix0))));
+			_mm256_storeu_pd(out + k, LerpAVX2(ix0, ix1, sy));
+		}
+
+		return k;
+	}
+}
+
+#endif
+
+void Perlin(const double* x, const double* y, double* out, size_t n)
+{
+	size_t k = 0;
+
+#ifdef PERLIN_AVX2
+	static const bool hasAVX2 = HasAVX2();
+	if (hasAVX2)
+	{
+		k = PerlinAVX2(x, y, out, n);
+	}
+#endif
+
+	// Remaining points
+	for (; k < n; k++)
+	{
+		out[k] = Perlin(x[k], y[k]);
+	}
+}
+
+void Perlin(const double* x, const double* y, double* out, double* dx, double* dy, size_t n)
+{
+	size_t k = 0;
+
+#ifdef PERLIN_AVX2
+	static const bool hasAVX2 = HasAVX2();
+	if (hasAVX2)
+	{
+		k = PerlinAVX2(x, y, out, dx, dy, n);
+	}
+#endif
+
+	// Remaining points
+	for (; k < n; k++)
+	{
+		out[k] = Perlin(x[k], y[k], dx[k], dy[k]);
+	}
 }
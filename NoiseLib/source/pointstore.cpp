@@ -0,0 +1,160 @@
+#include "pointstore.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace
+{
+	/// <summary>
+	/// Floor of the integer division by a positive number
+	/// </summary>
+	int FloorDiv(int a, int b)
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+}
+
+PointStore::PointStore(int seed, double eps, RandomGeneratorType randomGeneratorType) :
+	m_seed(seed),
+	m_eps(eps),
+	m_randomGeneratorType(randomGeneratorType)
+{
+}
+
+std::shared_ptr<PointStore> PointStore::shared(int seed, double eps, RandomGeneratorType randomGeneratorType)
+{
+	typedef std::tuple<int, double, RandomGeneratorType> Key;
+
+	static std::mutex registryMutex;
+	static std::map<Key, std::weak_ptr<PointStore> > registry;
+
+	const std::lock_guard<std::mutex> lock(registryMutex);
+
+	// Forget the stores that are not used anymore
+	for (auto it = registry.begin(); it != registry.end();)
+	{
+		if (it->second.expired())
+		{
+			it = registry.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	std::weak_ptr<PointStore>& entry = registry[Key(seed, eps, randomGeneratorType)];
+
+	std::shared_ptr<PointStore> store = entry.lock();
+	if (store == nullptr)
+	{
+		store = std::make_shared<PointStore>(seed, eps, randomGeneratorType);
+		entry = store;
+	}
+
+	return store;
+}
+
+Point2D PointStore::generatePoint(int x, int y, int resolution) const
+{
+	double px, py;
+
+	if (m_randomGeneratorType == RandomGeneratorType::CounterBased)
+	{
+		CounterRandomGenerator generator(m_seed, resolution, x, y, POINT_STREAM);
+		px = generator.uniform(m_eps, 1.0 - m_eps);
+		py = generator.uniform(m_eps, 1.0 - m_eps);
+	}
+	else
+	{
+		std::mt19937_64 generator = InitLegacyRandomGenerator(m_seed, x, y);
+
+		std::uniform_real_distribution<double> distribution(m_eps, 1.0 - m_eps);
+		px = distribution(generator);
+		py = distribution(generator);
+	}
+
+	return { double(x) + px, double(y) + py };
+}
+
+void PointStore::window(int x, int y, int width, int height, int resolution, Point2D* out) const
+{
+	// The legacy generator gives the same points at all resolutions
+	const int level = m_randomGeneratorType == RandomGeneratorType::CounterBased ? resolution : 0;
+
+	const int firstBlockX = FloorDiv(x, BLOCK_SIZE);
+	const int firstBlockY = FloorDiv(y, BLOCK_SIZE);
+	const int lastBlockX = FloorDiv(x + width - 1, BLOCK_SIZE);
+	const int lastBlockY = FloorDiv(y + height - 1, BLOCK_SIZE);
+
+	// Copy the part of the window covered by each block
+	for (int blockY = firstBlockY; blockY <= lastBlockY; blockY++)
+	{
+		for (int blockX = firstBlockX; blockX <= lastBlockX; blockX++)
+		{
+			const Block& block = GetBlock({ level, blockX, blockY });
+
+			const int startX = std::max(x, blockX * BLOCK_SIZE);
+			const int endX = std::min(x + width, (blockX + 1) * BLOCK_SIZE);
+			const int startY = std::max(y, blockY * BLOCK_SIZE);
+			const int endY = std::min(y + height, (blockY + 1) * BLOCK_SIZE);
+
+			for (int cellY = startY; cellY < endY; cellY++)
+			{
+				for (int cellX = startX; cellX < endX; cellX++)
+				{
+					out[(cellY - y) * width + cellX - x] = block[(cellY - blockY * BLOCK_SIZE) * BLOCK_SIZE + cellX - blockX * BLOCK_SIZE];
+				}
+			}
+		}
+	}
+}
+
+size_t PointStore::BlockKeyHash::operator()(const BlockKey& key) const
+{
+	const uint64_t packed = (uint64_t(uint32_t(key.x)) << 32) | uint64_t(uint32_t(key.y));
+
+	return size_t(MixBits(packed ^ MixBits(uint64_t(uint32_t(key.level)))));
+}
+
+const PointStore::Block& PointStore::GetBlock(const BlockKey& key) const
+{
+	{
+		const std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		const auto it = m_blocks.find(key);
+		if (it != m_blocks.end())
+		{
+			return *it->second;
+		}
+	}
+
+	// Generate the block without holding the lock, another thread may do the same
+	std::unique_ptr<Block> block = GenerateBlock(key);
+
+	const std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+	// Keep the first block inserted, both are identical
+	const auto it = m_blocks.try_emplace(key, std::move(block)).first;
+
+	return *it->second;
+}
+
+std::unique_ptr<PointStore::Block> PointStore::GenerateBlock(const BlockKey& key) const
+{
+	std::unique_ptr<Block> block = std::make_unique<Block>();
+
+	for (int i = 0; i < BLOCK_SIZE; i++)
+	{
+		for (int j = 0; j < BLOCK_SIZE; j++)
+		{
+			const int x = key.x * BLOCK_SIZE + j;
+			const int y = key.y * BLOCK_SIZE + i;
+
+			(*block)[i * BLOCK_SIZE + j] = generatePoint(x, y, key.level);
+		}
+	}
+
+	return block;
+}
@@ -0,0 +1,309 @@
+#include "segmentdistance.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SEGMENTDISTANCE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define SEGMENTDISTANCE_TARGET_AVX __attribute__((target("avx")))
+#else
+#define SEGMENTDISTANCE_TARGET_AVX
+#endif
+
+namespace
+{
+	template <typename T>
+	using DistSqFunction = void (*)(T, T, const T*, const T*, const T*, const T*, int, T*);
+
+	/// <summary>
+	/// Reference implementation, follows the operations of distToLineSegment
+	/// </summary>
+	template <typename T>
+	void DistSqScalar(T px, T py, const T* ax, const T* ay, const T* bx, const T* by, int count, T* out)
+	{
+		for (int n = 0; n < count; n++)
+		{
+			const T apx = px - ax[n];
+			const T apy = py - ay[n];
+			const T abx = bx[n] - ax[n];
+			const T aby = by[n] - ay[n];
+
+			const T normSq = abx * abx + aby * aby;
+			const T u = normSq <= T(0.0) ? T(0.0) : (apx * abx + apy * aby) / normSq;
+
+			if (u < T(0.0))
+			{
+				// P is closer to A
+				out[n] = apx * apx + apy * apy;
+			}
+			else if (u > T(1.0))
+			{
+				// P is closer to B
+				const T bpx = px - bx[n];
+				const T bpy = py - by[n];
+				out[n] = bpx * bpx + bpy * bpy;
+			}
+			else
+			{
+				// Projection of P is between A and B
+				const T cpx = px - (ax[n] + abx * u);
+				const T cpy = py - (ay[n] + aby * u);
+				out[n] = cpx * cpx + cpy * cpy;
+			}
+		}
+	}
+
+#ifdef SEGMENTDISTANCE_X86
+	void DistSqSSE2(double px, double py, const double* ax, const double* ay, const double* bx, const double* by, int count, double* out)
+	{
+		const __m128d vpx = _mm_set1_pd(px);
+		const __m128d vpy = _mm_set1_pd(py);
+		const __m128d zero = _mm_setzero_pd();
+		const __m128d one = _mm_set1_pd(1.0);
+
+		int n = 0;
+		for (; n + 2 <= count; n += 2)
+		{
+			const __m128d vax = _mm_loadu_pd(ax + n);
+			const __m128d vay = _mm_loadu_pd(ay + n);
+			const __m128d vbx = _mm_loadu_pd(bx + n);
+			const __m128d vby = _mm_loadu_pd(by + n);
+
+			const __m128d apx = _mm_sub_pd(vpx, vax);
+			const __m128d apy = _mm_sub_pd(vpy, vay);
+			const __m128d abx = _mm_sub_pd(vbx, vax);
+			const __m128d aby = _mm_sub_pd(vby, vay);
+
+			const __m128d normSq = _mm_add_pd(_mm_mul_pd(abx, abx), _mm_mul_pd(aby, aby));
+			const __m128d dot = _mm_add_pd(_mm_mul_pd(apx, abx), _mm_mul_pd(apy, aby));
+			const __m128d u = _mm_andnot_pd(_mm_cmple_pd(normSq, zero), _mm_div_pd(dot, normSq));
+
+			const __m128d distSqA = _mm_add_pd(_mm_mul_pd(apx, apx), _mm_mul_pd(apy, apy));
+
+			const __m128d bpx = _mm_sub_pd(vpx, vbx);
+			const __m128d bpy = _mm_sub_pd(vpy, vby);
+			const __m128d distSqB = _mm_add_pd(_mm_mul_pd(bpx, bpx), _mm_mul_pd(bpy, bpy));
+
+			const __m128d cpx = _mm_sub_pd(vpx, _mm_add_pd(vax, _mm_mul_pd(abx, u)));
+			const __m128d cpy = _mm_sub_pd(vpy, _mm_add_pd(vay, _mm_mul_pd(aby, u)));
+			const __m128d distSqC = _mm_add_pd(_mm_mul_pd(cpx, cpx), _mm_mul_pd(cpy, cpy));
+
+			const __m128d closerToA = _mm_cmplt_pd(u, zero);
+			const __m128d closerToB = _mm_andnot_pd(closerToA, _mm_cmpgt_pd(u, one));
+			const __m128d betweenAB = _mm_andnot_pd(_mm_or_pd(closerToA, closerToB), _mm_castsi128_pd(_mm_set1_epi64x(-1)));
+
+			const __m128d distSq = _mm_or_pd(_mm_or_pd(_mm_and_pd(closerToA, distSqA), _mm_and_pd(closerToB, distSqB)), _mm_and_pd(betweenAB, distSqC));
+			_mm_storeu_pd(out + n, distSq);
+		}
+
+		DistSqScalar(px, py, ax + n, ay + n, bx + n, by + n, count - n, out + n);
+	}
+
+	void DistSqSSE(float px, float py, const float* ax, const float* ay, const float* bx, const float* by, int count, float* out)
+	{
+		const __m128 vpx = _mm_set1_ps(px);
+		const __m128 vpy = _mm_set1_ps(py);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		int n = 0;
+		for (; n + 4 <= count; n += 4)
+		{
+			const __m128 vax = _mm_loadu_ps(ax + n);
+			const __m128 vay = _mm_loadu_ps(ay + n);
+			const __m128 vbx = _mm_loadu_ps(bx + n);
+			const __m128 vby = _mm_loadu_ps(by + n);
+
+			const __m128 apx = _mm_sub_ps(vpx, vax);
+			const __m128 apy = _mm_sub_ps(vpy, vay);
+			const __m128 abx = _mm_sub_ps(vbx, vax);
+			const __m128 aby = _mm_sub_ps(vby, vay);
+
+			const __m128 normSq = _mm_add_ps(_mm_mul_ps(abx, abx), _mm_mul_ps(aby, aby));
+			const __m128 dot = _mm_add_ps(_mm_mul_ps(apx, abx), _mm_mul_ps(apy, aby));
+			const __m128 u = _mm_andnot_ps(_mm_cmple_ps(normSq, zero), _mm_div_ps(dot, normSq));
+
+			const __m128 distSqA = _mm_add_ps(_mm_mul_ps(apx, apx), _mm_mul_ps(apy, apy));
+
+			const __m128 bpx = _mm_sub_ps(vpx, vbx);
+			const __m128 bpy = _mm_sub_ps(vpy, vby);
+			const __m128 distSqB = _mm_add_ps(_mm_mul_ps(bpx, bpx), _mm_mul_ps(bpy, bpy));
+
+			const __m128 cpx = _mm_sub_ps(vpx, _mm_add_ps(vax, _mm_mul_ps(abx, u)));
+			const __m128 cpy = _mm_sub_ps(vpy, _mm_add_ps(vay, _mm_mul_ps(aby, u)));
+			const __m128 distSqC = _mm_add_ps(_mm_mul_ps(cpx, cpx), _mm_mul_ps(cpy, cpy));
+
+			const __m128 closerToA = _mm_cmplt_ps(u, zero);
+			const __m128 closerToB = _mm_andnot_ps(closerToA, _mm_cmpgt_ps(u, one));
+			const __m128 betweenAB = _mm_andnot_ps(_mm_or_ps(closerToA, closerToB), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+			const __m128 distSq = _mm_or_ps(_mm_or_ps(_mm_and_ps(closerToA, distSqA), _mm_and_ps(closerToB, distSqB)), _mm_and_ps(betweenAB, distSqC));
+			_mm_storeu_ps(out + n, distSq);
+		}
+
+		DistSqScalar(px, py, ax + n, ay + n, bx + n, by + n, count - n, out + n);
+	}
+
+	SEGMENTDISTANCE_TARGET_AVX
+	void DistSqAVX(double px, double py, const double* ax, const double* ay, const double* bx, const double* by, int count, double* out)
+	{
+		const __m256d vpx = _mm256_set1_pd(px);
+		const __m256d vpy = _mm256_set1_pd(py);
+		const __m256d zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1.0);
+
+		int n = 0;
+		for (; n + 4 <= count; n += 4)
+		{
+			const __m256d vax = _mm256_loadu_pd(ax + n);
+			const __m256d vay = _mm256_loadu_pd(ay + n);
+			const __m256d vbx = _mm256_loadu_pd(bx + n);
+			const __m256d vby = _mm256_loadu_pd(by + n);
+
+			const __m256d apx = _mm256_sub_pd(vpx, vax);
+			const __m256d apy = _mm256_sub_pd(vpy, vay);
+			const __m256d abx = _mm256_sub_pd(vbx, vax);
+			const __m256d aby = _mm256_sub_pd(vby, vay);
+
+			const __m256d normSq = _mm256_add_pd(_mm256_mul_pd(abx, abx), _mm256_mul_pd(aby, aby));
+			const __m256d dot = _mm256_add_pd(_mm256_mul_pd(apx, abx), _mm256_mul_pd(apy, aby));
+			const __m256d u = _mm256_andnot_pd(_mm256_cmp_pd(normSq, zero, _CMP_LE_OQ), _mm256_div_pd(dot, normSq));
+
+			const __m256d distSqA = _mm256_add_pd(_mm256_mul_pd(apx, apx), _mm256_mul_pd(apy, apy));
+
+			const __m256d bpx = _mm256_sub_pd(vpx, vbx);
+			const __m256d bpy = _mm256_sub_pd(vpy, vby);
+			const __m256d distSqB = _mm256_add_pd(_mm256_mul_pd(bpx, bpx), _mm256_mul_pd(bpy, bpy));
+
+			const __m256d cpx = _mm256_sub_pd(vpx, _mm256_add_pd(vax, _mm256_mul_pd(abx, u)));
+			const __m256d cpy = _mm256_sub_pd(vpy, _mm256_add_pd(vay, _mm256_mul_pd(aby, u)));
+			const __m256d distSqC = _mm256_add_pd(_mm256_mul_pd(cpx, cpx), _mm256_mul_pd(cpy, cpy));
+
+			const __m256d closerToA = _mm256_cmp_pd(u, zero, _CMP_LT_OQ);
+			const __m256d closerToB = _mm256_andnot_pd(closerToA, _mm256_cmp_pd(u, one, _CMP_GT_OQ));
+			const __m256d betweenAB = _mm256_andnot_pd(_mm256_or_pd(closerToA, closerToB), _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ));
+
+			const __m256d distSq = _mm256_or_pd(_mm256_or_pd(_mm256_and_pd(closerToA, distSqA), _mm256_and_pd(closerToB, distSqB)), _mm256_and_pd(betweenAB, distSqC));
+			_mm256_storeu_pd(out + n, distSq);
+		}
+
+		// Avoid the penalty of mixing AVX and SSE instructions in the remaining segments
+		_mm256_zeroupper();
+
+		DistSqSSE2(px, py, ax + n, ay + n, bx + n, by + n, count - n, out + n);
+	}
+
+	SEGMENTDISTANCE_TARGET_AVX
+	void DistSqAVXFloat(float px, float py, const float* ax, const float* ay, const float* bx, const float* by, int count, float* out)
+	{
+		const __m256 vpx = _mm256_set1_ps(px);
+		const __m256 vpy = _mm256_set1_ps(py);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		int n = 0;
+		for (; n + 8 <= count; n += 8)
+		{
+			const __m256 vax = _mm256_loadu_ps(ax + n);
+			const __m256 vay = _mm256_loadu_ps(ay + n);
+			const __m256 vbx = _mm256_loadu_ps(bx + n);
+			const __m256 vby = _mm256_loadu_ps(by + n);
+
+			const __m256 apx = _mm256_sub_ps(vpx, vax);
+			const __m256 apy = _mm256_sub_ps(vpy, vay);
+			const __m256 abx = _mm256_sub_ps(vbx, vax);
+			const __m256 aby = _mm256_sub_ps(vby, vay);
+
+			const __m256 normSq = _mm256_add_ps(_mm256_mul_ps(abx, abx), _mm256_mul_ps(aby, aby));
+			const __m256 dot = _mm256_add_ps(_mm256_mul_ps(apx, abx), _mm256_mul_ps(apy, aby));
+			const __m256 u = _mm256_andnot_ps(_mm256_cmp_ps(normSq, zero, _CMP_LE_OQ), _mm256_div_ps(dot, normSq));
+
+			const __m256 distSqA = _mm256_add_ps(_mm256_mul_ps(apx, apx), _mm256_mul_ps(apy, apy));
+
+			const __m256 bpx = _mm256_sub_ps(vpx, vbx);
+			const __m256 bpy = _mm256_sub_ps(vpy, vby);
+			const __m256 distSqB = _mm256_add_ps(_mm256_mul_ps(bpx, bpx), _mm256_mul_ps(bpy, bpy));
+
+			const __m256 cpx = _mm256_sub_ps(vpx, _mm256_add_ps(vax, _mm256_mul_ps(abx, u)));
+			const __m256 cpy = _mm256_sub_ps(vpy, _mm256_add_ps(vay, _mm256_mul_ps(aby, u)));
+			const __m256 distSqC = _mm256_add_ps(_mm256_mul_ps(cpx, cpx), _mm256_mul_ps(cpy, cpy));
+
+			const __m256 closerToA = _mm256_cmp_ps(u, zero, _CMP_LT_OQ);
+			const __m256 closerToB = _mm256_andnot_ps(closerToA, _mm256_cmp_ps(u, one, _CMP_GT_OQ));
+			const __m256 betweenAB = _mm256_andnot_ps(_mm256_or_ps(closerToA, closerToB), _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ));
+
+			const __m256 distSq = _mm256_or_ps(_mm256_or_ps(_mm256_and_ps(closerToA, distSqA), _mm256_and_ps(closerToB, distSqB)), _mm256_and_ps(betweenAB, distSqC));
+			_mm256_storeu_ps(out + n, distSq);
+		}
+
+		// Avoid the penalty of mixing AVX and SSE instructions in the remaining segments
+		_mm256_zeroupper();
+
+		DistSqSSE(px, py, ax + n, ay + n, bx + n, by + n, count - n, out + n);
+	}
+
+	bool SupportsAVX()
+	{
+#if defined(__GNUC__)
+		return __builtin_cpu_supports("avx");
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		// The operating system must save the AVX registers
+		return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return false;
+#endif
+	}
+#endif
+
+	DistSqFunction<double> SelectDistSqFunction()
+	{
+#ifdef SEGMENTDISTANCE_X86
+		if (SupportsAVX())
+		{
+			return DistSqAVX;
+		}
+
+		return DistSqSSE2;
+#else
+		return DistSqScalar<double>;
+#endif
+	}
+
+	DistSqFunction<float> SelectDistSqFunctionFloat()
+	{
+#ifdef SEGMENTDISTANCE_X86
+		if (SupportsAVX())
+		{
+			return DistSqAVXFloat;
+		}
+
+		return DistSqSSE;
+#else
+		return DistSqScalar<float>;
+#endif
+	}
+}
+
+void distSqToLineSegments(double px, double py, const double* ax, const double* ay, const double* bx, const double* by, int count, double* out)
+{
+	// Select the implementation once, according to the processor
+	static const DistSqFunction<double> distSqFunction = SelectDistSqFunction();
+
+	distSqFunction(px, py, ax, ay, bx, by, count, out);
+}
+
+void distSqToLineSegments(float px, float py, const float* ax, const float* ay, const float* bx, const float* by, int count, float* out)
+{
+	// Select the implementation once, according to the processor
+	static const DistSqFunction<float> distSqFunction = SelectDistSqFunctionFloat();
+
+	distSqFunction(px, py, ax, ay, bx, by, count, out);
+}
@@ -2,12 +2,13 @@
 
 #include <cassert>
 
-Point2D CatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, double t)
+template <typename T>
+Point2DT<T> CatmullRomSpline(const Point2DT<T>& p0, const Point2DT<T>& p1, const Point2DT<T>& p2, const Point2DT<T>& p3, typename Point2DT<T>::Scalar t)
 {
-	const double t0 = 0.0;
-	const double t1 = dist(p0, p1) + t0;
-	const double t2 = dist(p1, p2) + t1;
-	const double t3 = dist(p2, p3) + t2;
+	const T t0 = 0.0;
+	const T t1 = dist(p0, p1) + t0;
+	const T t2 = dist(p1, p2) + t1;
+	const T t3 = dist(p2, p3) + t2;
 
 	assert(t0 != t1);
 	assert(t0 != t2);
@@ -15,22 +16,23 @@ Point2D CatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2
 	assert(t1 != t3);
 	assert(t2 != t3);
 
-	const Point2D a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
-	const Point2D a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
-	const Point2D a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
+	const Point2DT<T> a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
+	const Point2DT<T> a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
+	const Point2DT<T> a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
 
-	const Point2D b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
-	const Point2D b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
+	const Point2DT<T> b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
+	const Point2DT<T> b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
 
 	return b1 * ((t2 - t) / (t2 - t1)) + b2 * ((t - t1) / (t2 - t1));
 }
 
-Point3D CatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3, double t)
+template <typename T>
+Point3DT<T> CatmullRomSpline(const Point3DT<T>& p0, const Point3DT<T>& p1, const Point3DT<T>& p2, const Point3DT<T>& p3, typename Point3DT<T>::Scalar t)
 {
-	const double t0 = 0.0;
-	const double t1 = dist(p0, p1) + t0;
-	const double t2 = dist(p1, p2) + t1;
-	const double t3 = dist(p2, p3) + t2;
+	const T t0 = 0.0;
+	const T t1 = dist(p0, p1) + t0;
+	const T t2 = dist(p1, p2) + t1;
+	const T t3 = dist(p2, p3) + t2;
 
 	assert(t0 != t1);
 	assert(t0 != t2);
@@ -38,22 +40,23 @@ Point3D CatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2
 	assert(t1 != t3);
 	assert(t2 != t3);
 
-	const Point3D a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
-	const Point3D a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
-	const Point3D a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
+	const Point3DT<T> a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
+	const Point3DT<T> a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
+	const Point3DT<T> a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
 
-	const Point3D b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
-	const Point3D b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
+	const Point3DT<T> b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
+	const Point3DT<T> b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
 
 	return b1 * ((t2 - t) / (t2 - t1)) + b2 * ((t - t1) / (t2 - t1));
 }
 
-Point2D SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Point2D& p2, const Point2D& p3, double x)
+template <typename T>
+Point2DT<T> SubdivideCatmullRomSpline(const Point2DT<T>& p0, const Point2DT<T>& p1, const Point2DT<T>& p2, const Point2DT<T>& p3, typename Point2DT<T>::Scalar x)
 {
-	const double t0 = 0.0;
-	const double t1 = dist(p0, p1) + t0;
-	const double t2 = dist(p1, p2) + t1;
-	const double t3 = dist(p2, p3) + t2;
+	const T t0 = 0.0;
+	const T t1 = dist(p0, p1) + t0;
+	const T t2 = dist(p1, p2) + t1;
+	const T t3 = dist(p2, p3) + t2;
 
 	assert(t0 != t1);
 	assert(t0 != t2);
@@ -61,24 +64,25 @@ Point2D SubdivideCatmullRomSpline(const Point2D& p0, const Point2D& p1, const Po
 	assert(t2 != t3);
 
 	// Evaluate the Spline between p1 and p2
-	const double t = lerp(t1, t2, x);
+	const T t = lerp(t1, t2, x);
 
-	const Point2D a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
-	const Point2D a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
-	const Point2D a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
+	const Point2DT<T> a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
+	const Point2DT<T> a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
+	const Point2DT<T> a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
 
-	const Point2D b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
-	const Point2D b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
+	const Point2DT<T> b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
+	const Point2DT<T> b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
 
 	return b1 * ((t2 - t) / (t2 - t1)) + b2 * ((t - t1) / (t2 - t1));
 }
 
-Point3D SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Point3D& p2, const Point3D& p3, double x)
+template <typename T>
+Point3DT<T> SubdivideCatmullRomSpline(const Point3DT<T>& p0, const Point3DT<T>& p1, const Point3DT<T>& p2, const Point3DT<T>& p3, typename Point3DT<T>::Scalar x)
 {
-	const double t0 = 0.0;
-	const double t1 = dist(p0, p1) + t0;
-	const double t2 = dist(p1, p2) + t1;
-	const double t3 = dist(p2, p3) + t2;
+	const T t0 = 0.0;
+	const T t1 = dist(p0, p1) + t0;
+	const T t2 = dist(p1, p2) + t1;
+	const T t3 = dist(p2, p3) + t2;
 
 	assert(t0 != t1);
 	assert(t0 != t2);
@@ -86,14 +90,24 @@ Point3D SubdivideCatmullRomSpline(const Point3D& p0, const Point3D& p1, const Po
 	assert(t2 != t3);
 
 	// Evaluate the Spline between p1 and p2
-	const double t = lerp(t1, t2, x);
+	const T t = lerp(t1, t2, x);
 
-	const Point3D a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
-	const Point3D a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
-	const Point3D a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
+	const Point3DT<T> a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
+	const Point3DT<T> a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
+	const Point3DT<T> a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
 
-	const Point3D b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
-	const Point3D b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
+	const Point3DT<T> b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
+	const Point3DT<T> b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
 
 	return b1 * ((t2 - t) / (t2 - t1)) + b2 * ((t - t1) / (t2 - t1));
-}
\ No newline at end of file
+}
+
+// Instantiations in double and single precision
+#define INSTANTIATE_SPLINE(T) \
+	template Point2DT<T> CatmullRomSpline(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, T); \
+	template Point3DT<T> CatmullRomSpline(const Point3DT<T>&, const Point3DT<T>&, const Point3DT<T>&, const Point3DT<T>&, T); \
+	template Point2DT<T> SubdivideCatmullRomSpline(const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, const Point2DT<T>&, T); \
+	template Point3DT<T> SubdivideCatmullRomSpline(const Point3DT<T>&, const Point3DT<T>&, const Point3DT<T>&, const Point3DT<T>&, T);
+
+INSTANTIATE_SPLINE(double)
+INSTANTIATE_SPLINE(float)
@@ -0,0 +1,350 @@
+#include "tiledimagecontrolfunction.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "utils.h"
+
+namespace
+{
+	const char FILE_MAGIC[4] = { 'D', 'T', 'I', 'F' };
+	const uint32_t FILE_VERSION = 1;
+
+	/// <summary>
+	/// Pixels of an image of the pyramid, stored row by row
+	/// </summary>
+	template <typename P>
+	struct Pixels
+	{
+		const P* data;
+		std::ptrdiff_t stride;
+		int rows;
+		int cols;
+
+		P get(int i, int j) const
+		{
+			return data[std::clamp(i, 0, rows - 1) * stride + std::clamp(j, 0, cols - 1)];
+		}
+	};
+
+	size_t AlignOffset(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	/// <summary>
+	/// Throw if a condition on the content of a tiled file does not hold
+	/// </summary>
+	void CheckFile(bool condition, const std::string& filename, const std::string& problem)
+	{
+		if (!condition)
+		{
+			throw std::runtime_error("Invalid tiled image file " + filename + ": " + problem);
+		}
+	}
+
+	void WritePadding(std::ofstream& file, size_t offset)
+	{
+		const size_t position = size_t(file.tellp());
+		if (offset > position)
+		{
+			const std::vector<char> zeros(offset - position, 0);
+			file.write(zeros.data(), std::streamsize(zeros.size()));
+		}
+	}
+}
+
+TiledImageControlFunction::TiledImageControlFunction(const std::string& filename) :
+	m_file(std::make_unique<MappedFile>(filename)),
+	m_bytesPerPixel(0),
+	m_tileSize(0),
+	m_tileShift(0)
+{
+	// The file is read from disk, so it is checked in all builds
+	CheckFile(m_file->data() != nullptr, filename, "the file cannot be mapped");
+	CheckFile(m_file->size() >= sizeof(FileHeader), filename, "the file is smaller than its header");
+
+	FileHeader header;
+	std::memcpy(&header, m_file->data(), sizeof(FileHeader));
+
+	CheckFile(std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0, filename, "wrong magic number");
+	CheckFile(header.version == FILE_VERSION, filename, "unsupported version");
+	CheckFile(header.bytesPerPixel == 1 || header.bytesPerPixel == 2, filename, "unsupported number of bytes per pixel");
+	CheckFile(header.levelCount >= 1 && header.levelCount <= MAX_FILE_LEVELS, filename, "wrong number of levels");
+	CheckFile(header.tileSize >= 1 && header.tileSize <= MAX_TILE_SIZE && (header.tileSize & (header.tileSize - 1)) == 0, filename, "the tile size is not a power of two");
+
+	m_bytesPerPixel = int(header.bytesPerPixel);
+	m_tileSize = int(header.tileSize);
+	while ((1 << m_tileShift) < m_tileSize)
+	{
+		m_tileShift++;
+	}
+
+	for (uint32_t k = 0; k < header.levelCount; k++)
+	{
+		const FileLevel& fileLevel = header.levels[k];
+
+		const std::string name = "level " + std::to_string(k) + ": ";
+		CheckFile(fileLevel.rows > 1 && fileLevel.rows <= uint32_t(std::numeric_limits<int>::max()), filename, name + "wrong number of rows");
+		CheckFile(fileLevel.cols > 1 && fileLevel.cols <= uint32_t(std::numeric_limits<int>::max()), filename, name + "wrong number of columns");
+
+		// Tiles cover the image exactly, so that all the pixels read by Sample are in a tile
+		CheckFile(fileLevel.tilesX == (uint64_t(fileLevel.cols) + m_tileSize - 1) / m_tileSize, filename, name + "wrong number of tiles in a row");
+		CheckFile(fileLevel.tilesY == (uint64_t(fileLevel.rows) + m_tileSize - 1) / m_tileSize, filename, name + "wrong number of tiles in a column");
+
+		// Pixels are read in place, so they must be aligned
+		const uint64_t bytes = uint64_t(fileLevel.tilesX) * fileLevel.tilesY * m_tileSize * m_tileSize * m_bytesPerPixel;
+		CheckFile(fileLevel.offset % m_bytesPerPixel == 0, filename, name + "misaligned pixels");
+		CheckFile(fileLevel.offset <= m_file->size() && bytes <= m_file->size() - fileLevel.offset, filename, name + "the pixels are beyond the end of the file");
+
+		Level level;
+		level.rows = int(fileLevel.rows);
+		level.cols = int(fileLevel.cols);
+		level.tilesX = int(fileLevel.tilesX);
+		level.tilesY = int(fileLevel.tilesY);
+		level.offset = size_t(fileLevel.offset);
+		level.texelSize = std::max(1.0 / (level.rows - 1), 1.0 / (level.cols - 1));
+
+		m_pyramid.push_back(level);
+	}
+}
+
+bool TiledImageControlFunction::convert(const cv::Mat& image, const std::string& filename, int tileSize)
+{
+	assert(image.data != nullptr);
+	assert(image.rows > 1);
+	assert(image.cols > 1);
+	assert(tileSize > 0 && tileSize <= MAX_TILE_SIZE && (tileSize & (tileSize - 1)) == 0);
+
+	bool written = false;
+
+	switch (image.type())
+	{
+	case CV_8U:
+		written = Convert<uint8_t>(image, filename, tileSize);
+		break;
+	case CV_16U:
+		written = Convert<uint16_t>(image, filename, tileSize);
+		break;
+	}
+
+	return written;
+}
+
+double TiledImageControlFunction::EvaluateFilteredImpl(double x, double y, double footprint) const
+{
+	double value = 0.0;
+
+	EvaluateFilteredBatchImpl(&x, &y, &value, 1, footprint);
+
+	return value;
+}
+
+void TiledImageControlFunction::EvaluateFilteredBatchImpl(const double* x, const double* y, double* values, int n, double footprint) const
+{
+	// All the points have the same footprint and read the same image
+	const Level& level = m_pyramid[PyramidLevel(footprint)];
+
+	if (m_bytesPerPixel == 1)
+	{
+		SampleBatch<uint8_t>(level, x, y, values, n);
+	}
+	else
+	{
+		SampleBatch<uint16_t>(level, x, y, values, n);
+	}
+}
+
+void TiledImageControlFunction::PrefetchImpl(double xMin, double yMin, double xMax, double yMax, double footprint) const
+{
+	const Level& level = m_pyramid[PyramidLevel(footprint)];
+
+	// Rows and columns of the texels read by the bicubic filter in the region
+	const int firstRow = std::max(int(std::floor(std::clamp(yMin, 0.0, 1.0) * (level.rows - 1))) - 1, 0);
+	const int lastRow = std::min(int(std::ceil(std::clamp(yMax, 0.0, 1.0) * (level.rows - 1))) + 2, level.rows - 1);
+	const int firstCol = std::max(int(std::floor(std::clamp(xMin, 0.0, 1.0) * (level.cols - 1))) - 1, 0);
+	const int lastCol = std::min(int(std::ceil(std::clamp(xMax, 0.0, 1.0) * (level.cols - 1))) + 2, level.cols - 1);
+
+	const size_t tileBytes = size_t(m_tileSize) * m_tileSize * m_bytesPerPixel;
+
+	// The tiles of a row of tiles are contiguous in the file
+	const int firstTileX = firstCol >> m_tileShift;
+	const int lastTileX = lastCol >> m_tileShift;
+	for (int tileY = firstRow >> m_tileShift; tileY <= lastRow >> m_tileShift; tileY++)
+	{
+		const size_t first = level.offset + (size_t(tileY) * level.tilesX + firstTileX) * tileBytes;
+		m_file->prefetch(first, size_t(lastTileX - firstTileX + 1) * tileBytes);
+	}
+}
+
+size_t TiledImageControlFunction::PyramidLevel(double footprint) const
+{
+	size_t level = 0;
+	while (level + 1 < m_pyramid.size() && m_pyramid[level + 1].texelSize <= footprint)
+	{
+		level++;
+	}
+
+	return level;
+}
+
+template <typename P>
+double TiledImageControlFunction::Sample(const Level& level, double ri, double rj) const
+{
+	assert(0.0 <= ri && ri <= 1.0);
+	assert(0.0 <= rj && rj <= 1.0);
+
+	const P* tiles = reinterpret_cast<const P*>(m_file->data() + level.offset);
+	const size_t tileArea = size_t(m_tileSize) * m_tileSize;
+	const int mask = m_tileSize - 1;
+
+	// The index of the pixel (i, j) is the sum of a part depending on the row and one depending on the column
+	const auto rowIndex = [&](int i) {
+		i = std::clamp(i, 0, level.rows - 1);
+		return size_t(i >> m_tileShift) * level.tilesX * tileArea + size_t(i & mask) * m_tileSize;
+	};
+	const auto colIndex = [&](int j) {
+		j = std::clamp(j, 0, level.cols - 1);
+		return size_t(j >> m_tileShift) * tileArea + size_t(j & mask);
+	};
+
+	ri *= level.rows - 1;
+	rj *= level.cols - 1;
+
+	// If the coordinates are integer, return directly the value
+	if (nearbyint(ri) == ri && nearbyint(rj) == rj)
+	{
+		return double(tiles[rowIndex(int(ri)) + colIndex(int(rj))]) / std::numeric_limits<P>::max();
+	}
+
+	const auto i1 = int(floor(ri));
+	const auto j1 = int(floor(rj));
+
+	std::array<size_t, 4> rows;
+	std::array<size_t, 4> cols;
+	for (int k = 0; k < 4; k++)
+	{
+		rows[k] = rowIndex(i1 - 1 + k);
+		cols[k] = colIndex(j1 - 1 + k);
+	}
+
+	// Remap the values between 0 and 1
+	std::array<double, 16> p;
+	for (int k = 0; k < 4; k++)
+	{
+		for (int l = 0; l < 4; l++)
+		{
+			p[k * 4 + l] = double(tiles[rows[k] + cols[l]]) / std::numeric_limits<P>::max();
+		}
+	}
+
+	const double interpolation = bi_cubic_interpolate(p.data(), 4, ri - floor(ri), rj - floor(rj));
+
+	return std::clamp(interpolation, 0.0, 1.0);
+}
+
+template <typename P>
+void TiledImageControlFunction::SampleBatch(const Level& level, const double* x, const double* y, double* values, int n) const
+{
+	for (int k = 0; k < n; k++)
+	{
+		values[k] = Sample<P>(level, std::clamp(y[k], 0.0, 1.0), std::clamp(x[k], 0.0, 1.0));
+	}
+}
+
+template <typename P>
+bool TiledImageControlFunction::Convert(const cv::Mat& image, const std::string& filename, int tileSize)
+{
+	FileHeader header;
+	std::memset(&header, 0, sizeof(FileHeader));
+	std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+	header.version = FILE_VERSION;
+	header.bytesPerPixel = sizeof(P);
+	header.tileSize = uint32_t(tileSize);
+
+	// Size and position of the images of the pyramid, down to 2x2 pixels
+	int rows = image.rows;
+	int cols = image.cols;
+	size_t offset = AlignOffset(sizeof(FileHeader), FILE_ALIGNMENT);
+	while (true)
+	{
+		assert(header.levelCount < MAX_FILE_LEVELS);
+
+		FileLevel& level = header.levels[header.levelCount++];
+		level.rows = uint32_t(rows);
+		level.cols = uint32_t(cols);
+		level.tilesX = uint32_t((cols + tileSize - 1) / tileSize);
+		level.tilesY = uint32_t((rows + tileSize - 1) / tileSize);
+		level.offset = offset;
+
+		offset = AlignOffset(offset + size_t(level.tilesX) * level.tilesY * tileSize * tileSize * sizeof(P), FILE_ALIGNMENT);
+
+		if (rows <= 2 && cols <= 2)
+		{
+			break;
+		}
+
+		rows = std::max((rows + 1) / 2, 2);
+		cols = std::max((cols + 1) / 2, 2);
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+
+	// The first image is read from the input, the others are computed from the previous one
+	Pixels<P> pixels = { image.ptr<P>(0), image.ptr<P>(1) - image.ptr<P>(0), image.rows, image.cols };
+	std::vector<P> buffer;
+
+	std::vector<P> tile(size_t(tileSize) * tileSize);
+	for (uint32_t k = 0; k < header.levelCount; k++)
+	{
+		const FileLevel& level = header.levels[k];
+
+		WritePadding(file, size_t(level.offset));
+
+		// Pixels of the tiles outside the image repeat its border
+		for (int tileY = 0; tileY < int(level.tilesY); tileY++)
+		{
+			for (int tileX = 0; tileX < int(level.tilesX); tileX++)
+			{
+				for (int i = 0; i < tileSize; i++)
+				{
+					for (int j = 0; j < tileSize; j++)
+					{
+						tile[size_t(i) * tileSize + j] = pixels.get(tileY * tileSize + i, tileX * tileSize + j);
+					}
+				}
+
+				file.write(reinterpret_cast<const char*>(tile.data()), std::streamsize(tile.size() * sizeof(P)));
+			}
+		}
+
+		if (k + 1 < header.levelCount)
+		{
+			// Average the pixels 2 by 2
+			const FileLevel& next = header.levels[k + 1];
+			std::vector<P> downsampled(size_t(next.rows) * next.cols);
+			for (int i = 0; i < int(next.rows); i++)
+			{
+				for (int j = 0; j < int(next.cols); j++)
+				{
+					const uint32_t sum = uint32_t(pixels.get(2 * i, 2 * j)) + pixels.get(2 * i, 2 * j + 1) + pixels.get(2 * i + 1, 2 * j) + pixels.get(2 * i + 1, 2 * j + 1);
+					downsampled[size_t(i) * next.cols + j] = P((sum + 2) / 4);
+				}
+			}
+
+			buffer = std::move(downsampled);
+			pixels = { buffer.data(), std::ptrdiff_t(next.cols), int(next.rows), int(next.cols) };
+		}
+	}
+
+	return bool(file);
+}
@@ -19,11 +19,31 @@ double bi_cubic_interpolate(const std::array<std::array<double, 4>, 4>& p, doubl
 	assert(0.0 <= u && u <= 1.0);
 	assert(0.0 <= v && v <= 1.0);
 
-	std::array<double, 4> temp{};
+	return bi_cubic_interpolate(p[0].data(), 4, u, v);
+}
+
+double bi_cubic_interpolate(const double* p, std::ptrdiff_t stride, double u, double v)
+{
+	assert(0.0 <= u && u <= 1.0);
+	assert(0.0 <= v && v <= 1.0);
+
+	// Columns of the 4x4 values, the rows are the lanes
+	std::array<double, 4> p0, p1, p2, p3;
 	for (unsigned int i = 0; i < 4; i++)
 	{
-		temp[i] = cubic_interpolate(p[i], v);
+		p0[i] = p[i * stride];
+		p1[i] = p[i * stride + 1];
+		p2[i] = p[i * stride + 2];
+		p3[i] = p[i * stride + 3];
 	}
+
+	std::array<double, 4> temp;
+#pragma omp simd
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		temp[i] = p1[i] + 0.5 * v * (p2[i] - p0[i] + v * (2.0 * p0[i] - 5.0 * p1[i] + 4.0 * p2[i] - p3[i] + v * (3.0 * (p1[i] - p2[i]) + p3[i] - p0[i])));
+	}
+
 	return cubic_interpolate(temp, u);
 }
 